@@ -0,0 +1,483 @@
+// benchmark suite, run with `make bench`. every benchmark runs at each ball
+// count and reports one row, as CSV (default) or JSON:
+//   ./bench.out [--json] [--sizes 10,100,1000] [--min-time 0.2]
+// or runs the consistency checks instead and exits non zero on a failure:
+//   ./bench.out --check
+// past ~600 balls the layout no longer fits the table without overlapping,
+// those rows are stress numbers rather than anything a real game does
+#include "../src/utility.h"
+#include "../src/ball.h"
+#include "../src/kernels.h"
+#include "../src/simulation.h"
+#include "../src/cue.h"
+#include "../src/render.h"
+#include "../src/text.h"
+#include "../src/batch.h"
+#include "../src/thread_pool.h"
+#include "../src/replay.h"
+#include "../src/grid.h"
+
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// shots that don't settle in this many steps are cut off
+constexpr int BENCH_MAX_STEPS = 5000;
+constexpr float BREAK_POWER = 18.0f;
+
+struct Result {
+    std::string name;
+    int balls;
+    long iterations;
+    double seconds;
+    std::string unit; // what one iteration is
+};
+
+static double min_time = 0.2;
+
+// repeats body until min_time has been spent inside it. setup runs before
+// every iteration and isn't counted
+static Result measure(const std::string& name, int balls, const std::string& unit,
+                      const std::function<void()>& setup, const std::function<void()>& body) {
+    long iterations = 0;
+    double spent = 0;
+    while (spent < min_time || iterations < 3) {
+        setup();
+        Clock::time_point start = Clock::now();
+        body();
+        spent += std::chrono::duration<double>(Clock::now() - start).count();
+        ++iterations;
+    }
+    return {name, balls, iterations, spent, unit};
+}
+
+// object balls on a lattice over the whole table, spacing shrinks with the
+// count so the big layouts overlap. jittered so rows don't hit symmetrically
+static std::vector<Position> bench_layout(int count) {
+    std::mt19937 rng(count);
+    std::uniform_real_distribution<float> jitter(-0.5f, 0.5f);
+
+    const float left = 200, right = TABLE_WIDTH - 40, top = 40, bottom = TABLE_HEIGHT - 40;
+    float spacing = std::sqrt((right - left) * (bottom - top) / count);
+    spacing = std::fmin(spacing, 2*BALL_RADIUS + 4.0f);
+    int columns = std::max(1, (int)((right - left) / spacing));
+
+    std::vector<Position> layout;
+    for (int i=0; i<count; ++i) {
+        float x = left + (i % columns) * spacing + jitter(rng);
+        float y = top + (i / columns) * spacing + jitter(rng);
+        layout.push_back({x, std::fmin(y, bottom)});
+    }
+    return layout;
+}
+
+// count includes the cueball, 10 is the normal rack
+static Simulation bench_table(int count) {
+    Simulation sim;
+    if (count != 10) sim.load_layout(bench_layout(std::max(count - 1, 1)));
+    return sim;
+}
+
+// a few steps into the break, when the most balls are moving
+static Simulation mid_break(int count) {
+    Simulation sim = bench_table(count);
+    sim.shoot(0.0f, BREAK_POWER);
+    for (int i=0; i<40 && !sim.is_at_rest(); ++i) sim.step();
+    return sim;
+}
+
+static void bench_physics(int count, std::vector<Result>& results) {
+    // BallStore::move over every ball, velocities refreshed each iteration
+    BallStore store(count);
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> pos(0, TABLE_WIDTH), vel(-10, 10);
+    for (int i=0; i<count; ++i) store.add({pos(rng), pos(rng) / 2}, {255, 255, 255, 255});
+    auto refill = [&]() {
+        for (int i=0; i<store.count; ++i) {
+            store.dx[i] = vel(rng);
+            store.dy[i] = vel(rng);
+        }
+    };
+    results.push_back(measure("ball_move", count, "pass over all balls", refill, [&]() {
+        for (int i=0; i<store.count; ++i) store.move(i);
+    }));
+    results.push_back(measure("integrate_kernel", count, "pass over all balls", refill, [&]() {
+        integrate_balls(store, KernelPath::Auto);
+    }));
+
+    Simulation base = mid_break(count);
+    Simulation sim = base;
+    auto restore = [&]() { sim = base; };
+    results.push_back(measure("check_collisions", count, "call", restore, [&]() { sim.check_collisions(); }));
+    results.push_back(measure("check_pockets", count, "call", restore, [&]() { sim.check_pockets(); }));
+
+    Simulation rack = bench_table(count);
+    results.push_back(measure("break_to_rest", count, "shot", [&]() { sim = rack; }, [&]() {
+        sim.shoot(0.0f, BREAK_POWER);
+        sim.run_until_rest(BENCH_MAX_STEPS);
+    }));
+
+    // the same two with every contact of a step solved together
+    Simulation simultaneous_base = base;
+    simultaneous_base.set_contacts(Contacts::Simultaneous);
+    auto restore_simultaneous = [&]() { sim = simultaneous_base; };
+    results.push_back(measure("check_collisions_simultaneous", count, "call", restore_simultaneous, [&]() { sim.check_collisions(); }));
+
+    Simulation simultaneous_rack = rack;
+    simultaneous_rack.set_contacts(Contacts::Simultaneous);
+    results.push_back(measure("break_to_rest_simultaneous", count, "shot", [&]() { sim = simultaneous_rack; }, [&]() {
+        sim.shoot(0.0f, BREAK_POWER);
+        sim.run_until_rest(BENCH_MAX_STEPS);
+    }));
+
+    // the same shots one at a time and through the batched engine
+    if (count > MAX_BALLS) return;
+    std::vector<BatchShot> shots(4*BATCH_BLOCK);
+    std::uniform_real_distribution<float> angle(-3.14159f, 3.14159f), power(5, 20);
+    for (BatchShot& shot : shots) shot = {angle(rng), power(rng)};
+    std::string unit = std::to_string(shots.size()) + " random shots";
+
+    auto none = []() {};
+    results.push_back(measure("shots_single", count, unit, none, [&]() {
+        for (const BatchShot& shot : shots) {
+            sim = rack;
+            sim.shoot(shot.angle, shot.power);
+            sim.run_until_rest(BENCH_MAX_STEPS);
+        }
+    }));
+
+    static ThreadPool pool;
+    std::vector<BatchResult> batch_results;
+    BatchEngine serial;
+    results.push_back(measure("shots_batch", count, unit, none, [&]() {
+        serial.run(rack, shots, batch_results, BENCH_MAX_STEPS);
+    }));
+    BatchEngine parallel(&pool);
+    results.push_back(measure("shots_batch_parallel", count, unit + " on " + std::to_string(pool.size()) + " threads", none, [&]() {
+        parallel.run(rack, shots, batch_results, BENCH_MAX_STEPS);
+    }));
+}
+
+static void bench_render(int count, SDL_Renderer* renderer, std::vector<Result>& results) {
+    Simulation sim = mid_break(count);
+    const BallStore& balls = sim.get_balls();
+    Position cue_pos = balls.get_position(CUE_BALL);
+
+    Cue cue;
+    cue.toggle_guideline();
+    cue.update(cue_pos, TABLE_WIDTH - 40, TABLE_HEIGHT / 2 + 3);
+    auto none = []() {};
+    results.push_back(measure("guideline", count, "call", none, [&]() {
+        cue.draw_guideline(renderer, cue_pos, BALL_RADIUS, TABLE_WIDTH, TABLE_HEIGHT, balls);
+    }));
+
+    // same draws as Table::render, the HUD in the built in font
+    CircleBatch circles;
+    bool sprites = circles.load(renderer);
+    TextRenderer text;
+    text.load(renderer);
+    results.push_back(measure(sprites ? "render_frame" : "render_frame_fallback", count, "frame", none, [&]() {
+        SDL_SetRenderDrawColor(renderer, 0, 100, 0, 255);
+        SDL_RenderClear(renderer);
+        if (sprites) {
+            for (const Position& pocket : sim.get_pockets()) circles.add(pocket, POCKET_RADIUS, {0, 0, 0, 255});
+            for (int i=0; i<balls.count; ++i) {
+                if (balls.active[i]) circles.add(balls.get_position(i), BALL_RADIUS, balls.color[i]);
+            }
+            circles.flush();
+        } else {
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+            for (const Position& pocket : sim.get_pockets()) {
+                render_draw_filled_circle(renderer, pocket.x, pocket.y, POCKET_RADIUS);
+            }
+            for (int i=0; i<balls.count; ++i) {
+                if (balls.active[i]) render_draw_ball(renderer, balls.get_position(i), balls.color[i]);
+            }
+        }
+        cue.draw(renderer, cue_pos);
+        cue.draw_guideline(renderer, cue_pos, BALL_RADIUS, TABLE_WIDTH, TABLE_HEIGHT, balls);
+        text.draw("Score: "+std::to_string(sim.get_score()), 40, 20);
+        text.draw("Power: "+std::to_string((int)cue.getPower()), TABLE_WIDTH-150, 20);
+        text.draw("[G] to toggle guideline", 100, TABLE_HEIGHT-35);
+        text.flush();
+        SDL_RenderPresent(renderer);
+    }));
+    text.unload();
+    circles.unload();
+}
+
+// one line per check, false if it failed
+static bool report(const std::string& name, bool ok, const std::string& detail) {
+    std::cout << (ok ? "ok   " : "FAIL ") << name << ": " << detail << "\n";
+    return ok;
+}
+
+// back to back runs with fewer and more tasks than workers, a worker left
+// over from one run must never take or miscount the next run's tasks
+static bool check_thread_pool() {
+    bool ok = true;
+    for (int threads : {2, 3, 8}) {
+        ThreadPool pool(threads);
+        std::vector<std::atomic<int>> counts(4*threads + 1);
+        int runs = 0, wrong = 0;
+        for (int round=0; round<20000; ++round) {
+            int tasks = 1 + round % (int)counts.size();
+            for (int t=0; t<tasks; ++t) counts[t] = 0;
+            std::atomic<int> bad_worker(0);
+            pool.run(tasks, [&](int worker, int task) {
+                if (worker < 0 || worker >= pool.size()) ++bad_worker;
+                if (task % 3 == 0) std::this_thread::yield();
+                ++counts[task];
+            });
+            for (int t=0; t<tasks; ++t) wrong += counts[t] != 1;
+            wrong += bad_worker;
+            ++runs;
+        }
+        ok &= report("thread_pool", wrong == 0, std::to_string(runs) + " runs on " + std::to_string(threads) +
+                     " threads, " + std::to_string(wrong) + " tasks lost or repeated");
+    }
+    return ok;
+}
+
+// shots played with every integrate and contact search run through the
+// scalar kernel as well, the SIMD path has to match it bit for bit
+static bool check_kernels() {
+    bool ok = true;
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> angle(-3.14159f, 3.14159f), power(5, 20);
+    for (int count : {10, 100, 400}) {
+        Simulation rack = bench_table(count);
+        rack.set_verify_kernels(true);
+        long steps = 0;
+        int mismatches = 0, diverged = 0;
+        // shots follow on from each other, so they start with balls that
+        // came to rest in play rather than fresh off the rack
+        Simulation sim = rack;
+        Simulation plain = rack;
+        plain.set_verify_kernels(false);
+        for (int shot=0; shot<30; ++shot) {
+            // the break first, then random shots
+            float a = shot == 0 ? 0.0f : angle(rng);
+            float p = shot == 0 ? BREAK_POWER : power(rng);
+            sim.shoot(a, p);
+            plain.shoot(a, p);
+            steps += sim.run_until_rest(BENCH_MAX_STEPS);
+            plain.run_until_rest(BENCH_MAX_STEPS);
+            // verifying mustn't change what gets played
+            diverged += state_hash(sim) != state_hash(plain);
+        }
+        mismatches = sim.get_kernel_mismatches();
+        ok &= report("kernels", mismatches == 0 && diverged == 0,
+                     std::string(kernel_path_name(resolve_kernel_path(KernelPath::Auto))) + " vs scalar, " +
+                     std::to_string(count) + " balls, " + std::to_string(steps) + " steps, " +
+                     std::to_string(mismatches) + " mismatches, " + std::to_string(diverged) + " diverged");
+    }
+    return ok;
+}
+
+// the grid has to hand out every touching pair the all pairs loop would
+// test, checked on every step of sequential shots. with simultaneous
+// contacts the outcome doesn't depend on pair order, so the two broad
+// phases have to end every shot on the same state as well
+static bool check_broad_phase() {
+    bool ok = true;
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> angle(-3.14159f, 3.14159f), power(5, 20);
+    for (int count : {10, 100, 500}) {
+        Simulation rack = bench_table(count);
+        BroadPhaseGrid grid;
+        std::vector<int> moving;
+        std::vector<std::pair<int, int>> pairs;
+        long steps = 0;
+        int missed = 0;
+        for (int shot=0; shot<20; ++shot) {
+            Simulation sim = rack;
+            if (shot == 0) sim.shoot(0.0f, BREAK_POWER);
+            else sim.shoot(angle(rng), power(rng));
+            for (int k=0; k<BENCH_MAX_STEPS && !sim.is_at_rest(); ++k, ++steps) {
+                const BallStore& balls = sim.get_balls();
+                moving.clear();
+                for (int i=0; i<balls.count; ++i) {
+                    if (balls.active[i] && balls.is_moving(i)) moving.push_back(i);
+                }
+                grid.update(balls);
+                grid.find_pairs(balls, moving, pairs);
+                for (int i=0; i<balls.count; ++i) {
+                    for (int j=i+1; j<balls.count; ++j) {
+                        if (!balls.active[i] || !balls.active[j]) continue;
+                        if (!balls.is_moving(i) && !balls.is_moving(j)) continue;
+                        if (!balls.check_collision(i, j)) continue;
+                        missed += !std::binary_search(pairs.begin(), pairs.end(), std::make_pair(i, j));
+                    }
+                }
+                sim.step();
+            }
+        }
+        ok &= report("grid_pairs", missed == 0, std::to_string(count) + " balls, " + std::to_string(steps) +
+                     " steps, " + std::to_string(missed) + " touching pairs missed");
+
+        Simulation grid_rack = rack;
+        grid_rack.set_contacts(Contacts::Simultaneous);
+        Simulation brute_rack = grid_rack;
+        brute_rack.set_broad_phase(BroadPhase::BruteForce);
+        int diverged = 0;
+        for (int shot=0; shot<20; ++shot) {
+            float a = shot == 0 ? 0.0f : angle(rng);
+            float p = shot == 0 ? BREAK_POWER : power(rng);
+            Simulation g = grid_rack, b = brute_rack;
+            g.shoot(a, p);
+            b.shoot(a, p);
+            g.run_until_rest(BENCH_MAX_STEPS);
+            b.run_until_rest(BENCH_MAX_STEPS);
+            diverged += state_hash(g) != state_hash(b);
+        }
+        ok &= report("broad_phase", diverged == 0, "grid vs brute force with simultaneous contacts, " +
+                     std::to_string(count) + " balls, " + std::to_string(diverged) + " of 20 shots diverged");
+    }
+    return ok;
+}
+
+// closest pair of active balls, under a diameter is an overlap a missed
+// collision left behind
+static float min_gap(const Simulation& sim) {
+    const BallStore& balls = sim.get_balls();
+    float gap = INFINITY;
+    for (int i=0; i<balls.count; ++i) {
+        for (int j=i+1; j<balls.count; ++j) {
+            if (!balls.active[i] || !balls.active[j]) continue;
+            gap = std::fmin(gap, std::hypot(balls.x[i] - balls.x[j], balls.y[i] - balls.y[j]));
+        }
+    }
+    return gap;
+}
+
+// the event engine against stepping: a slow cueball catching a ball that
+// stops just ahead of it, which the event engine used to roll through once
+// the ball stopped, then breaks that must never come to rest overlapping
+static bool check_event_engine() {
+    bool ok = true;
+    float gaps[2];
+    for (Engine engine : {Engine::Stepped, Engine::Event}) {
+        Simulation sim;
+        sim.load_layout({{402, 200}});
+        TableSnapshot start;
+        sim.save(start);
+        start.x[CUE_BALL] = 380;
+        start.y[CUE_BALL] = 200;
+        start.dx[1] = 0.12f;
+        sim.restore(start);
+        sim.set_engine(engine);
+        sim.shoot(0.0f, 0.3f);
+        sim.run_until_rest(BENCH_MAX_STEPS);
+        gaps[engine == Engine::Event] = min_gap(sim);
+    }
+    ok &= report("event_engine", gaps[1] >= 2*BALL_RADIUS && std::fabs(gaps[1] - gaps[0]) < 1.0f,
+                 "catching a stopping ball, " + std::to_string(gaps[1]) + " px apart vs " +
+                 std::to_string(gaps[0]) + " stepped");
+
+    std::mt19937 rng(13);
+    std::uniform_real_distribution<float> aim(-0.1f, 0.1f), power(10, 20);
+    int overlapping = 0;
+    for (int shot=0; shot<300; ++shot) {
+        Simulation sim;
+        sim.set_engine(Engine::Event);
+        sim.shoot(aim(rng), power(rng));
+        sim.run_until_rest(BENCH_MAX_STEPS);
+        overlapping += min_gap(sim) < 2*BALL_RADIUS - 0.01f;
+    }
+    ok &= report("event_engine", overlapping == 0, "300 breaks, " + std::to_string(overlapping) + " ended overlapping");
+    return ok;
+}
+
+static int run_checks() {
+    bool ok = true;
+    ok &= check_thread_pool();
+    ok &= check_kernels();
+    ok &= check_broad_phase();
+    ok &= check_event_engine();
+    return ok ? 0 : EXIT_FAILURE;
+}
+
+static void print_csv(const std::vector<Result>& results) {
+    std::cout << "benchmark,balls,iterations,seconds,ns_per_iter,iters_per_sec,unit\n";
+    for (const Result& r : results) {
+        std::cout << r.name << "," << r.balls << "," << r.iterations << "," << r.seconds << ","
+                  << r.seconds * 1e9 / r.iterations << "," << r.iterations / r.seconds << "," << r.unit << "\n";
+    }
+}
+
+static void print_json(const std::vector<Result>& results) {
+    std::cout << "{\n  \"kernel_path\": \"" << kernel_path_name(resolve_kernel_path(KernelPath::Auto)) << "\",\n";
+    std::cout << "  \"results\": [\n";
+    for (size_t i=0; i<results.size(); ++i) {
+        const Result& r = results[i];
+        std::cout << "    {\"benchmark\": \"" << r.name << "\", \"balls\": " << r.balls
+                  << ", \"iterations\": " << r.iterations << ", \"seconds\": " << r.seconds
+                  << ", \"ns_per_iter\": " << r.seconds * 1e9 / r.iterations
+                  << ", \"iters_per_sec\": " << r.iterations / r.seconds
+                  << ", \"unit\": \"" << r.unit << "\"}" << (i+1 < results.size() ? ",\n" : "\n");
+    }
+    std::cout << "  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<int> sizes = {10, 100, 500, 1000, 4000};
+    bool json = false;
+    bool check = false;
+
+    for (int i=1; i<argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (std::strcmp(argv[i], "--check") == 0) {
+            check = true;
+        } else if (std::strcmp(argv[i], "--sizes") == 0 && i+1 < argc) {
+            sizes.clear();
+            std::stringstream list(argv[++i]);
+            std::string item;
+            while (std::getline(list, item, ',')) sizes.push_back(std::atoi(item.c_str()));
+        } else if (std::strcmp(argv[i], "--min-time") == 0 && i+1 < argc) {
+            min_time = std::atof(argv[++i]);
+        } else {
+            std::cerr << "Unknown argument: " << argv[i] << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (check) return run_checks();
+
+    // software renderer on a plain surface, no window or display needed
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, TABLE_WIDTH, TABLE_HEIGHT, 32, SDL_PIXELFORMAT_RGBA32);
+    SDL_Renderer* renderer = surface ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+    if (!renderer) {
+        std::cerr << "Renderer Creation Error: " << SDL_GetError() << "\n";
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<Result> results;
+    for (int count : sizes) {
+        if (count <= 0) continue;
+        bench_physics(count, results);
+        bench_render(count, renderer, results);
+    }
+
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(surface);
+
+    if (json) print_json(results);
+    else print_csv(results);
+    return 0;
+}
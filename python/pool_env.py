@@ -0,0 +1,123 @@
+"""Thin ctypes binding over src/pool_env.h, build the library with `make poolenv`.
+
+    env = PoolEnv(batch=4096)
+    obs = env.reset()
+    obs, rewards, dones = env.step(angles, powers)
+
+obs, rewards and dones are buffers the C side writes into directly, numpy
+arrays when numpy is installed, array.array otherwise. They're reused by
+every call, so copy them to keep a step's values around.
+"""
+
+import ctypes
+import os
+from array import array
+
+try:
+    import numpy as np
+except ImportError:
+    np = None
+
+_LIBRARY = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "libpoolenv.so")
+
+_float_p = ctypes.POINTER(ctypes.c_float)
+_byte_p = ctypes.POINTER(ctypes.c_uint8)
+
+
+def _load(path):
+    lib = ctypes.CDLL(path)
+    lib.pool_env_create.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_char_p]
+    lib.pool_env_create.restype = ctypes.c_void_p
+    lib.pool_env_destroy.argtypes = [ctypes.c_void_p]
+    lib.pool_env_batch.argtypes = [ctypes.c_void_p]
+    lib.pool_env_obs_size.argtypes = [ctypes.c_void_p]
+    lib.pool_env_set_contacts.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.pool_env_set_cache.argtypes = [ctypes.c_void_p, ctypes.c_int]
+    lib.pool_env_cache_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_longlong),
+                                         ctypes.POINTER(ctypes.c_longlong)]
+    lib.pool_env_reset.argtypes = [ctypes.c_void_p, _byte_p, _float_p]
+    lib.pool_env_step.argtypes = [ctypes.c_void_p, _float_p, _float_p, _float_p, _float_p, _byte_p]
+    return lib
+
+
+def _buffer(code, count):
+    if np is not None:
+        return np.zeros(count, dtype=np.float32 if code == "f" else np.uint8)
+    return array(code, bytes(count * array(code).itemsize))
+
+
+def _pointer(buf, code, count, ctype):
+    """pointer to buf's memory, converting only inputs that aren't already
+    contiguous float32/uint8 of the right length"""
+    if np is not None:
+        buf = np.ascontiguousarray(buf, dtype=np.float32 if code == "f" else np.uint8)
+    elif not (isinstance(buf, array) and buf.typecode == code):
+        buf = array(code, buf)
+    if len(buf) != count:
+        raise ValueError("expected %d values, got %d" % (count, len(buf)))
+    if np is not None:
+        return buf, buf.ctypes.data_as(ctypes.POINTER(ctype))
+    return buf, ctypes.cast((ctype * count).from_buffer(buf), ctypes.POINTER(ctype))
+
+
+class PoolEnv:
+    def __init__(self, batch, threads=0, physics_hz=60, max_shots=0, game="9ball", library=_LIBRARY):
+        self._lib = _load(library)
+        self._env = self._lib.pool_env_create(batch, threads, physics_hz, max_shots, game.encode())
+        if not self._env:
+            raise ValueError("invalid environment settings")
+
+        self.batch = batch
+        self.obs_size = self._lib.pool_env_obs_size(self._env)
+        self.obs = _buffer("f", batch * self.obs_size)
+        self.rewards = _buffer("f", batch)
+        self.dones = _buffer("B", batch)
+        if np is not None:
+            self.obs = self.obs.reshape(batch, self.obs_size)
+
+        self._obs_p = self._writable(self.obs, ctypes.c_float)
+        self._rewards_p = self._writable(self.rewards, ctypes.c_float)
+        self._dones_p = self._writable(self.dones, ctypes.c_uint8)
+
+    @staticmethod
+    def _writable(buf, ctype):
+        if np is not None:
+            return buf.ctypes.data_as(ctypes.POINTER(ctype))
+        return ctypes.cast((ctype * len(buf)).from_buffer(buf), ctypes.POINTER(ctype))
+
+    def close(self):
+        if self._env:
+            self._lib.pool_env_destroy(self._env)
+            self._env = None
+
+    def __del__(self):
+        self.close()
+
+    def set_contacts(self, contacts):
+        """how balls touching at once are resolved, sequential or simultaneous"""
+        if not self._lib.pool_env_set_contacts(self._env, contacts.encode()):
+            raise ValueError("unknown contact solver: " + contacts)
+
+    def set_cache(self, entries):
+        """remember up to entries shot outcomes across tables, 0 turns it off"""
+        self._lib.pool_env_set_cache(self._env, entries)
+
+    def cache_stats(self):
+        """(hits, misses) since the cache was set"""
+        hits, misses = ctypes.c_longlong(), ctypes.c_longlong()
+        self._lib.pool_env_cache_stats(self._env, ctypes.byref(hits), ctypes.byref(misses))
+        return hits.value, misses.value
+
+    def reset(self, mask=None):
+        """re-racks every table, or only those where mask is set"""
+        mask_p = None
+        if mask is not None:
+            mask, mask_p = _pointer(mask, "B", self.batch, ctypes.c_uint8)
+        self._lib.pool_env_reset(self._env, mask_p, self._obs_p)
+        return self.obs
+
+    def step(self, angles, powers):
+        angles, angles_p = _pointer(angles, "f", self.batch, ctypes.c_float)
+        powers, powers_p = _pointer(powers, "f", self.batch, ctypes.c_float)
+        self._lib.pool_env_step(self._env, angles_p, powers_p, self._obs_p, self._rewards_p, self._dones_p)
+        return self.obs, self.rewards, self.dones
@@ -1,89 +1,124 @@
 
 #include "ball.h"
 #include <algorithm>
+#include <cmath>
 
-Ball::Ball(Position pos, SDL_Color col) : m_pos(pos), m_vel({0, 0}), m_initial_pos(pos), color(col) {}
+BallStore::BallStore(int capacity)
+    : x(capacity), y(capacity), dx(capacity), dy(capacity),
+      active(capacity), initial(capacity), color(capacity),
+      count(0), num_active(0) {}
 
-Position Ball::get_position() const { return m_pos; }
-Velocity Ball::get_velocity() const { return m_vel; }
-bool Ball::is_moving() const { return m_vel.dx != 0 || m_vel.dy != 0; }
+int BallStore::capacity() const { return x.size(); }
 
-void Ball::reset() {
-    m_pos = m_initial_pos;
-    m_vel = {0,0};
+int BallStore::add(Position pos, Color col) {
+    if (count == capacity()) return -1;
+
+    int i = count++;
+    initial[i] = pos;
+    color[i] = col;
+    reset_ball(i);
+    active[i] = 1;
+    ++num_active;
+    return i;
+}
+
+void BallStore::clear() {
+    count = 0;
+    num_active = 0;
 }
 
-void Ball::draw(SDL_Renderer* renderer) const {
-    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
-    render_draw_filled_circle(renderer, m_pos.x, m_pos.y, BALL_RADIUS);
+void BallStore::reset() {
+    for (int i=0; i<count; ++i) {
+        reset_ball(i);
+        active[i] = 1;
+    }
+    num_active = count;
 }
 
-void Ball::move() {
-    m_pos.x += m_vel.dx;
-    m_pos.y += m_vel.dy;
-    
-    m_vel.dx *= DECELERATION;
-    m_vel.dy *= DECELERATION;
+void BallStore::reset_ball(int i) {
+    x[i] = initial[i].x;
+    y[i] = initial[i].y;
+    dx[i] = 0;
+    dy[i] = 0;
+}
+
+void BallStore::deactivate(int i) {
+    if (!active[i]) return;
+    active[i] = 0;
+    dx[i] = 0;
+    dy[i] = 0;
+    --num_active;
+}
+
+Position BallStore::get_position(int i) const { return {x[i], y[i]}; }
+Velocity BallStore::get_velocity(int i) const { return {dx[i], dy[i]}; }
+bool BallStore::is_moving(int i) const { return dx[i] != 0 || dy[i] != 0; }
+
+void BallStore::move(int i, float dt, float damping) {
+    x[i] += dx[i] * dt;
+    y[i] += dy[i] * dt;
+
+    dx[i] *= damping;
+    dy[i] *= damping;
 
     // trunc velocities to near-zero
-    if (std::fabs(m_vel.dx) < 0.1f) m_vel.dx = 0;
-    if (std::fabs(m_vel.dy) < 0.1f) m_vel.dy = 0;
+    if (std::fabs(dx[i]) < MIN_SPEED) dx[i] = 0;
+    if (std::fabs(dy[i]) < MIN_SPEED) dy[i] = 0;
 
     // bounce off table edges
-    if (m_pos.x - BALL_RADIUS < 0 || m_pos.x + BALL_RADIUS > TABLE_WIDTH) {
-        m_vel.dx = -m_vel.dx;
+    if (x[i] - BALL_RADIUS < 0 || x[i] + BALL_RADIUS > TABLE_WIDTH) {
+        dx[i] = -dx[i];
     }
-    if (m_pos.y - BALL_RADIUS < 0 || m_pos.y + BALL_RADIUS > TABLE_HEIGHT) {
-        m_vel.dy = -m_vel.dy;
+    if (y[i] - BALL_RADIUS < 0 || y[i] + BALL_RADIUS > TABLE_HEIGHT) {
+        dy[i] = -dy[i];
     }
 
     // assert position is within bounds
-    m_pos.x = std::clamp(m_pos.x, BALL_RADIUS, (float)TABLE_WIDTH - BALL_RADIUS);
-    m_pos.y = std::clamp(m_pos.y, BALL_RADIUS, (float)TABLE_HEIGHT - BALL_RADIUS);
+    x[i] = std::clamp(x[i], BALL_RADIUS, (float)TABLE_WIDTH - BALL_RADIUS);
+    y[i] = std::clamp(y[i], BALL_RADIUS, (float)TABLE_HEIGHT - BALL_RADIUS);
 }
 
-void Ball::apply_force(float angle, float power) {
-    m_vel.dx += power * std::cos(angle);
-    m_vel.dy += power * std::sin(angle);
+void BallStore::apply_force(int i, float angle, float power) {
+    dx[i] += power * std::cos(angle);
+    dy[i] += power * std::sin(angle);
 }
 
-bool Ball::check_collision(const Ball& other) {
-    int dx = m_pos.x - other.m_pos.x;
-    int dy = m_pos.y - other.m_pos.y;
-    float dist = std::sqrt(dx*dx + dy*dy);
-    return dist <= (2*BALL_RADIUS);
+bool BallStore::check_collision(int i, int j) const {
+    float dist_x = x[i] - x[j];
+    float dist_y = y[i] - y[j];
+    return dist_x*dist_x + dist_y*dist_y <= (2*BALL_RADIUS)*(2*BALL_RADIUS);
 }
 
-// move both balls (this, and other)
-void Ball::resolve_collision(Ball& other) {
-    float dx = other.m_pos.x - m_pos.x;
-    float dy = other.m_pos.y - m_pos.y;
-    float dist = std::sqrt(dx*dx + dy*dy);
+// move both balls (i, and j)
+void BallStore::resolve_collision(int i, int j) {
+    float nx = x[j] - x[i];
+    float ny = y[j] - y[i];
+    float dist = std::sqrt(nx*nx + ny*ny);
 
     if (dist < 0.0001f) return; // div by zero
 
     // normalize
-    dx /= dist;
-    dy /= dist;
-    
+    nx /= dist;
+    ny /= dist;
+
     // relative vel
-    float v_relX = m_vel.dx - other.m_vel.dx;
-    float v_relY = m_vel.dy - other.m_vel.dy;
+    float v_relX = dx[i] - dx[j];
+    float v_relY = dy[i] - dy[j];
 
-    float dot_prod = v_relX*dx + v_relY*dy;
+    float dot_prod = v_relX*nx + v_relY*ny;
 
     if (dot_prod > 0) {
         // they are moving towards each other
-        m_vel.dx -= dot_prod * dx;
-        m_vel.dy -= dot_prod * dy;
-        other.m_vel.dx += dot_prod * dx;
-        other.m_vel.dy += dot_prod * dy;
+        dx[i] -= dot_prod * nx;
+        dy[i] -= dot_prod * ny;
+        dx[j] += dot_prod * nx;
+        dy[j] += dot_prod * ny;
 
         // prevent overlap
         float overlap = (2*BALL_RADIUS-dist)/2.0f;
-        m_pos.x -= overlap * dx;
-        m_pos.y -= overlap * dy;
-        other.m_pos.x += overlap * dx;
-        other.m_pos.y += overlap * dy;
+        x[i] -= overlap * nx;
+        y[i] -= overlap * ny;
+        x[j] += overlap * nx;
+        y[j] += overlap * ny;
     }
 }
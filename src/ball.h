@@ -4,25 +4,41 @@
 
 #include "utility.h"
 
-class Ball {
-private:
-    Position m_pos;
-    Velocity m_vel;
-    Position m_initial_pos;
-    SDL_Color color;
-
-public:
-    Ball(Position pos, SDL_Color col);
-
-    Position get_position() const;
-    Velocity get_velocity() const;
-    bool is_moving() const;
+#include <vector>
+
+constexpr int CUE_BALL = 0;
+constexpr int MAX_BALLS = 16;
+
+// structure-of-arrays storage for every ball on the table, cue ball in slot 0.
+// slot index is the ball's id: pocketing only clears the active flag, nothing
+// is moved or freed, so the arrays are allocated once up front
+struct BallStore {
+    std::vector<float> x, y;
+    std::vector<float> dx, dy;
+    std::vector<std::uint8_t> active;
+    std::vector<Position> initial;
+    std::vector<Color> color;
+    int count;
+    int num_active;
+
+    explicit BallStore(int capacity = MAX_BALLS);
+
+    int capacity() const;
+    // returns the new ball's id, or -1 when the store is full
+    int add(Position pos, Color col);
+    void clear();
     void reset();
-    void draw(SDL_Renderer* renderer) const;
-    void move();
-    void apply_force(float angle, float power);
-    bool check_collision(const Ball& other);
-    void resolve_collision(Ball& other);
+    void reset_ball(int i);
+    void deactivate(int i);
+
+    Position get_position(int i) const;
+    Velocity get_velocity(int i) const;
+    bool is_moving(int i) const;
+    void apply_force(int i, float angle, float power);
+    // dt is in 60 Hz frames, damping is DECELERATION^dt
+    void move(int i, float dt = 1.0f, float damping = DECELERATION);
+    bool check_collision(int i, int j) const;
+    void resolve_collision(int i, int j);
 };
 
 #endif
@@ -0,0 +1,289 @@
+#include "batch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// one block of tables: the shared store plus which shot each lane holds and
+// that table's rules state
+struct BatchBlock {
+    BallStore store;
+    int balls, lanes;
+    std::vector<int> table; // result index per lane, -1 once retired
+    std::vector<int> score, num_active, steps;
+    std::vector<std::uint8_t> was_moving;
+    int live;
+
+    BatchBlock() : store(0), balls(0), lanes(0), live(0) {}
+
+    int slot(int ball, int lane) const { return ball*lanes + lane; }
+};
+
+BatchEngine::BatchEngine(ThreadPool* pool)
+    : pool(pool), kernel_path(resolve_kernel_path(KernelPath::Auto)) {}
+
+void BatchEngine::set_kernel_path(KernelPath path) { kernel_path = resolve_kernel_path(path); }
+
+// copies the kept lanes of from densely into to
+static void pack(const std::vector<int>& keep, const BallStore& from, int from_lanes,
+                 BallStore& to, int balls) {
+    int lanes = keep.size();
+    to = BallStore(balls * lanes);
+    for (int b=0; b<balls; ++b) {
+        for (int k=0; k<lanes; ++k) {
+            int s = b*from_lanes + keep[k];
+            int d = to.add(from.initial[s], from.color[s]);
+            to.x[d] = from.x[s];
+            to.y[d] = from.y[s];
+            to.dx[d] = from.dx[s];
+            to.dy[d] = from.dy[s];
+            to.active[d] = from.active[s];
+        }
+    }
+}
+
+void BatchEngine::run_block(const Simulation& start, const BatchShot* shots, BatchResult* results,
+                            int tables, int max_steps) const {
+    const BallStore& rack = start.get_balls();
+    const PocketZones& zones = start.get_pocket_zones();
+    const float dt = start.get_time_step();
+    const float damping = std::pow(DECELERATION, dt);
+
+    BatchBlock block;
+    block.balls = rack.count;
+    block.lanes = tables;
+    block.live = tables;
+    block.store = BallStore(rack.count * tables);
+    for (int b=0; b<rack.count; ++b) {
+        for (int t=0; t<tables; ++t) {
+            int s = block.store.add(rack.initial[b], rack.color[b]);
+            block.store.x[s] = rack.x[b];
+            block.store.y[s] = rack.y[b];
+            block.store.dx[s] = rack.dx[b];
+            block.store.dy[s] = rack.dy[b];
+            block.store.active[s] = rack.active[b];
+        }
+    }
+    block.table.resize(tables);
+    block.score.assign(tables, start.get_score());
+    block.num_active.assign(tables, rack.num_active);
+    block.steps.assign(tables, 0);
+    for (int t=0; t<tables; ++t) {
+        block.table[t] = t;
+        block.store.apply_force(block.slot(CUE_BALL, t), shots[t].angle, shots[t].power);
+    }
+
+    BallStore& s = block.store;
+    // records which of the lane's balls are moving, for the next step's
+    // pocket pass, and whether any are
+    auto refresh = [&](int lane) {
+        bool any = false;
+        for (int b=0; b<block.balls; ++b) {
+            int i = block.slot(b, lane);
+            block.was_moving[i] = s.active[i] && s.is_moving(i);
+            any |= block.was_moving[i];
+        }
+        return any;
+    };
+    auto retire = [&](int lane) {
+        BatchResult& result = results[block.table[lane]];
+        TableSnapshot& end = result.end;
+        end.count = block.balls;
+        end.num_active = block.num_active[lane];
+        end.score = block.score[lane];
+        end.frame = block.steps[lane];
+        for (int b=0; b<block.balls; ++b) {
+            int i = block.slot(b, lane);
+            end.x[b] = s.x[i];
+            end.y[b] = s.y[i];
+            end.dx[b] = s.dx[i];
+            end.dy[b] = s.dy[i];
+            end.active[b] = s.active[i];
+            s.active[i] = 0; // the kernel skips it from now on
+        }
+        result.steps = block.steps[lane];
+        block.table[lane] = -1;
+        --block.live;
+    };
+
+    block.was_moving.assign(s.count, 0);
+    for (int t=0; t<tables; ++t) {
+        if (!refresh(t)) retire(t);
+    }
+
+    const RuleSet& rules = start.get_rules();
+
+    // everything in Simulation::substep after the integrate, for lane t
+    auto finish_substep = [&](int t) {
+        int cue = block.slot(CUE_BALL, t);
+        if (zones.find(s.x[cue], s.y[cue]) != -1) {
+            block.score[t] -= rules.scratch_penalty;
+            s.reset_ball(cue);
+        }
+
+        // the brute force pass from Simulation::check_collisions. a resting
+        // ball only tests moving ones after it, so once nothing past it is
+        // moving it can be skipped. last_moving can go stale high when a
+        // hit stops a ball, which only costs a few extra tests
+        int last_moving = -1;
+        for (int b=0; b<block.balls; ++b) {
+            if (block.was_moving[block.slot(b, t)]) last_moving = b;
+        }
+        for (int bi=0; bi<block.balls; ++bi) {
+            int i = block.slot(bi, t);
+            if (!s.active[i]) continue;
+            if (s.is_moving(i)) last_moving = std::max(last_moving, bi);
+            else if (last_moving <= bi) continue;
+
+            for (int bj=bi+1; bj<block.balls; ++bj) {
+                int j = block.slot(bj, t);
+                if (!s.is_moving(i)) {
+                    if (s.active[j] && s.is_moving(j) && s.check_collision(i, j)) {
+                        s.resolve_collision(i, j);
+                        last_moving = std::max(last_moving, bj);
+                    }
+                    continue;
+                }
+
+                int hit = bj;
+                while (hit < block.balls && !(s.active[block.slot(hit, t)] && s.check_collision(i, block.slot(hit, t)))) ++hit;
+                if (hit == block.balls) break;
+
+                s.resolve_collision(i, block.slot(hit, t));
+                last_moving = std::max(last_moving, hit);
+                bj = hit;
+            }
+        }
+
+        for (int b=1; b<block.balls; ++b) {
+            int i = block.slot(b, t);
+            if (!block.was_moving[i] && !s.is_moving(i)) continue;
+            if (s.active[i] && zones.find(s.x[i], s.y[i]) != -1) {
+                s.active[i] = 0;
+                s.dx[i] = 0;
+                s.dy[i] = 0;
+                --block.num_active[t];
+                block.score[t] += b < MAX_BALLS ? rules.points[b] : 1;
+            }
+        }
+
+        if (block.num_active[t] == 1) {
+            for (int b=0; b<block.balls; ++b) {
+                s.reset_ball(block.slot(b, t));
+                s.active[block.slot(b, t)] = 1;
+            }
+            block.num_active[t] = block.balls;
+        }
+    };
+
+    // the same split Simulation::step would pick, from the lane's fastest ball
+    auto substeps = [&](int t) {
+        if (!start.get_substepping()) return 1;
+        float max_speed = 0;
+        for (int b=0; b<block.balls; ++b) {
+            int i = block.slot(b, t);
+            if (block.was_moving[i]) max_speed = std::max(max_speed, std::max(std::fabs(s.dx[i]), std::fabs(s.dy[i])));
+        }
+        return substeps_for_speed(max_speed, dt);
+    };
+    auto move_lane = [&](int t, float step_dt, float step_damping) {
+        for (int b=0; b<block.balls; ++b) {
+            int i = block.slot(b, t);
+            if (s.active[i]) s.move(i, step_dt, step_damping);
+        }
+    };
+
+    std::vector<int> split;
+    while (block.live > 0) {
+        int lanes = block.lanes;
+
+        // one kernel pass over the block when no table needs splitting,
+        // which is every step once the break has slowed down
+        bool uniform = true;
+        split.assign(lanes, 1);
+        for (int t=0; t<lanes; ++t) {
+            if (block.table[t] == -1) continue;
+            split[t] = substeps(t);
+            if (split[t] != 1) uniform = false;
+        }
+
+        if (uniform) integrate_balls(s, kernel_path, dt, damping);
+
+        for (int t=0; t<lanes; ++t) {
+            if (block.table[t] == -1) continue;
+
+            if (uniform) {
+                finish_substep(t);
+            } else if (split[t] == 1) {
+                move_lane(t, dt, damping);
+                finish_substep(t);
+            } else {
+                float sub_dt, sub_damping;
+                substep_params(dt, split[t], sub_dt, sub_damping);
+                for (int k=0; k<split[t]; ++k) {
+                    if (k > 0 && !refresh(t)) break;
+                    move_lane(t, sub_dt, sub_damping);
+                    finish_substep(t);
+                }
+            }
+
+            ++block.steps[t];
+            if (!refresh(t) || block.steps[t] >= max_steps) retire(t);
+        }
+
+        // repack once an eighth of the lanes have gone idle
+        if (block.live > 0 && block.live <= lanes - std::max(lanes/8, 1)) {
+            std::vector<int> keep;
+            for (int t=0; t<lanes; ++t) {
+                if (block.table[t] != -1) keep.push_back(t);
+            }
+
+            BallStore packed(0);
+            pack(keep, s, lanes, packed, block.balls);
+            s = std::move(packed);
+
+            std::vector<int> table, score, num_active, steps;
+            for (int t : keep) {
+                table.push_back(block.table[t]);
+                score.push_back(block.score[t]);
+                num_active.push_back(block.num_active[t]);
+                steps.push_back(block.steps[t]);
+            }
+            block.table.swap(table);
+            block.score.swap(score);
+            block.num_active.swap(num_active);
+            block.steps.swap(steps);
+            block.lanes = keep.size();
+            block.was_moving.resize(s.count);
+            for (int t=0; t<block.lanes; ++t) refresh(t);
+        }
+    }
+}
+
+bool BatchEngine::run(const Simulation& start, const std::vector<BatchShot>& shots,
+                      std::vector<BatchResult>& results, int max_steps) const {
+    results.resize(shots.size());
+    if (start.get_balls().count > MAX_BALLS) {
+        std::cerr << "Batch Error: " << start.get_balls().count << " balls won't fit a snapshot\n";
+        return false;
+    }
+    if (start.get_engine() != Engine::Stepped || start.get_contacts() != Contacts::Sequential) {
+        std::cerr << "Batch Error: only the stepped engine with sequential contacts can be batched\n";
+        return false;
+    }
+
+    int total = shots.size();
+    int blocks = (total + BATCH_BLOCK - 1) / BATCH_BLOCK;
+    auto task = [&](int, int b) {
+        int first = b * BATCH_BLOCK;
+        run_block(start, shots.data() + first, results.data() + first, std::min(BATCH_BLOCK, total - first), max_steps);
+    };
+
+    if (pool) {
+        pool->run(blocks, task);
+    } else {
+        for (int b=0; b<blocks; ++b) task(0, b);
+    }
+    return true;
+}
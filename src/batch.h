@@ -0,0 +1,52 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "utility.h"
+#include "ball.h"
+#include "kernels.h"
+#include "simulation.h"
+#include "thread_pool.h"
+
+#include <vector>
+
+// tables stepped together per block, and the unit handed to each worker
+constexpr int BATCH_BLOCK = 256;
+
+struct BatchShot {
+    float angle, power;
+};
+
+struct BatchResult {
+    TableSnapshot end; // table at rest, or where max_steps cut it off
+    int steps;
+};
+
+// plays many independent shots from the same starting table at once. a
+// block of tables shares one BallStore laid out ball-major, slot b*lanes+t
+// is ball b of table t, so the integrate kernel's SIMD lanes run across
+// tables instead of across one rack. collisions and pockets go table by
+// table with the same ops in the same order as Simulation's stepped engine
+// with sequential contacts, so every result is bit-identical to running the
+// shot there. tables that come to rest drop out and the block is repacked
+// to keep its lanes full
+class BatchEngine {
+private:
+    ThreadPool* pool;
+    KernelPath kernel_path;
+
+    void run_block(const Simulation& start, const BatchShot* shots, BatchResult* results, int tables, int max_steps) const;
+
+public:
+    // without a pool every block runs on the calling thread
+    explicit BatchEngine(ThreadPool* pool = nullptr);
+
+    void set_kernel_path(KernelPath path);
+
+    // start must fit in a TableSnapshot and use Engine::Stepped with
+    // Contacts::Sequential, the only modes the lanes reproduce. false if it
+    // doesn't, otherwise results has one entry per shot
+    bool run(const Simulation& start, const std::vector<BatchShot>& shots,
+             std::vector<BatchResult>& results, int max_steps = 100000) const;
+};
+
+#endif
@@ -0,0 +1,151 @@
+#include "break_analysis.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+// breaks played between writes, per worker
+constexpr int BREAK_CHUNK = 1024;
+
+BreakOptions default_break_options() {
+    BreakOptions options;
+    options.breaks = 1000;
+    options.cue_jitter = 10.0f;
+    options.angle_jitter = 0.02f;
+    options.min_power = 0.75f * FPS/3.0f;
+    options.max_power = FPS/3.0f;
+    options.max_steps = 20000;
+    options.physics_hz = FPS;
+    options.game = Game::NineBall;
+    options.contacts = Contacts::Sequential;
+    options.seed = 1;
+    return options;
+}
+
+void BreakSummary::add(const BreakResult& result) {
+    ++breaks;
+    if (result.scratches > 0) ++scratched;
+    if (result.cut_off) ++cut_off;
+    total_steps += result.steps;
+
+    int pocketed = std::min(result.pocketed, (int)pocketed_hist.size() - 1);
+    ++pocketed_hist[pocketed];
+    int steps = std::min(result.steps, (int)steps_hist.size() - 1);
+    ++steps_hist[steps];
+    for (size_t p=0; p<pocket_drops.size(); ++p) pocket_drops[p] += result.drops[p];
+}
+
+int BreakSummary::steps_percentile(double fraction) const {
+    long long target = std::ceil(breaks * fraction);
+    long long seen = 0;
+    for (size_t s=0; s<steps_hist.size(); ++s) {
+        seen += steps_hist[s];
+        if (seen >= target && seen > 0) return s;
+    }
+    return steps_hist.size() - 1;
+}
+
+static void play_break(Simulation& local, const TableSnapshot& start, Position head,
+                       const BreakOptions& options, long long index, BreakResult& result) {
+    std::seed_seq seq{options.seed, (unsigned)index, (unsigned)(index >> 32)};
+    std::mt19937 rng(seq);
+    std::uniform_real_distribution<float> jitter(-options.cue_jitter, options.cue_jitter);
+    std::uniform_real_distribution<float> aim(-options.angle_jitter, options.angle_jitter);
+    std::uniform_real_distribution<float> powers(options.min_power, options.max_power);
+
+    TableSnapshot rack = start;
+    rack.x[CUE_BALL] += jitter(rng);
+    rack.y[CUE_BALL] += jitter(rng);
+    local.restore(rack);
+
+    result.cue_x = rack.x[CUE_BALL];
+    result.cue_y = rack.y[CUE_BALL];
+    result.angle = std::atan2(head.y - result.cue_y, head.x - result.cue_x) + aim(rng);
+    result.power = powers(rng);
+
+    local.shoot(result.angle, result.power);
+    result.steps = local.run_until_rest(options.max_steps);
+    result.frames = result.steps * local.get_time_step();
+    result.cut_off = !local.is_at_rest();
+
+    result.pocketed = 0;
+    result.scratches = 0;
+    std::fill(result.drops, result.drops + MAX_POCKETS, 0);
+    for (const PocketEvent& event : local.get_pocketed()) {
+        if (event.ball == CUE_BALL) ++result.scratches;
+        else ++result.pocketed;
+        if (event.pocket >= 0) ++result.drops[event.pocket];
+    }
+}
+
+BreakSummary analyze_breaks(const BreakOptions& options, ThreadPool& pool, std::ostream& csv) {
+    Simulation sim;
+    sim.set_rules(rules_for(options.game));
+    sim.set_step_rate(options.physics_hz);
+    sim.set_contacts(options.contacts);
+    TableSnapshot start;
+    sim.save(start);
+    Position head = sim.get_balls().get_position(1);
+    int pockets = std::min((int)sim.get_pockets().size(), MAX_POCKETS);
+
+    BreakSummary summary = {};
+    summary.time_step = sim.get_time_step();
+    summary.pocketed_hist.assign(sim.get_balls().count, 0);
+    summary.steps_hist.assign(options.max_steps + 1, 0);
+    summary.pocket_drops.assign(pockets, 0);
+
+    csv << "break,cue_x,cue_y,angle,power,pocketed,scratches,steps,frames,cut_off";
+    for (int p=0; p<pockets; ++p) csv << ",pocket_" << p;
+    csv << "\n";
+
+    std::vector<Simulation> copies(pool.size(), sim);
+    std::vector<BreakResult> results((size_t)BREAK_CHUNK * pool.size());
+
+    for (long long first=0; first<options.breaks; first+=results.size()) {
+        int count = std::min((long long)results.size(), options.breaks - first);
+
+        pool.run(count, [&](int worker, int task) {
+            play_break(copies[worker], start, head, options, first + task, results[task]);
+        });
+
+        for (int i=0; i<count; ++i) {
+            const BreakResult& r = results[i];
+            summary.add(r);
+
+            csv << first + i << ',' << r.cue_x << ',' << r.cue_y << ',' << r.angle << ',' << r.power << ','
+                << r.pocketed << ',' << r.scratches << ',' << r.steps << ',' << r.frames << ',' << r.cut_off;
+            for (int p=0; p<pockets; ++p) csv << ',' << (int)r.drops[p];
+            csv << "\n";
+        }
+    }
+    csv.flush();
+    return summary;
+}
+
+void print_break_summary(const BreakSummary& summary, const Simulation& sim, std::ostream& out) {
+    if (summary.breaks == 0) return;
+
+    double breaks = summary.breaks;
+    out << summary.breaks << " breaks, " << 100.0 * summary.scratched / breaks << "% scratched, "
+        << summary.cut_off << " cut off\n";
+    out << "steps to rest: mean " << summary.total_steps / breaks
+        << ", p50 " << summary.steps_percentile(0.5)
+        << ", p99 " << summary.steps_percentile(0.99) << "\n";
+    out << "frames to rest: mean " << summary.total_steps * summary.time_step / breaks
+        << ", p50 " << summary.steps_percentile(0.5) * summary.time_step
+        << ", p99 " << summary.steps_percentile(0.99) * summary.time_step << "\n";
+
+    out << "balls pocketed:";
+    for (size_t n=0; n<summary.pocketed_hist.size(); ++n) {
+        if (summary.pocketed_hist[n] == 0) continue;
+        out << " " << n << ": " << 100.0 * summary.pocketed_hist[n] / breaks << "%";
+    }
+    out << "\n";
+
+    out << "drops by pocket:";
+    const std::vector<Position>& pockets = sim.get_pockets();
+    for (size_t p=0; p<summary.pocket_drops.size(); ++p) {
+        out << " (" << pockets[p].x << "," << pockets[p].y << "): " << summary.pocket_drops[p];
+    }
+    out << "\n";
+}
@@ -0,0 +1,64 @@
+#ifndef BREAK_ANALYSIS_H
+#define BREAK_ANALYSIS_H
+
+#include "utility.h"
+#include "simulation.h"
+#include "thread_pool.h"
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+constexpr int MAX_POCKETS = 8;
+
+struct BreakOptions {
+    long long breaks;
+    float cue_jitter;   // px either way from the cue ball's spot
+    float angle_jitter; // radians either side of dead on the head ball
+    float min_power, max_power;
+    int max_steps;      // a break still rolling by then is cut off
+    int physics_hz;
+    Game game;
+    Contacts contacts;
+    unsigned seed;
+};
+
+BreakOptions default_break_options();
+
+struct BreakResult {
+    float cue_x, cue_y;
+    float angle, power;
+    int pocketed; // object balls
+    int scratches;
+    int steps;
+    float frames; // time to rest in 60 Hz frames, steps at the physics rate
+    bool cut_off;
+    std::uint8_t drops[MAX_POCKETS]; // balls into each pocket, cue included
+};
+
+// running totals, nothing here grows with the number of breaks
+struct BreakSummary {
+    long long breaks;
+    long long scratched; // breaks with at least one scratch
+    long long cut_off;   // breaks that hit max_steps
+    long long total_steps;
+    float time_step; // frames per step, to report steps as time to rest
+    std::vector<long long> pocketed_hist; // breaks by object balls pocketed
+    std::vector<long long> steps_hist;    // breaks by steps to rest
+    std::vector<long long> pocket_drops;  // balls by pocket
+
+    void add(const BreakResult& result);
+    // steps to rest at or below which fraction of breaks came to rest
+    int steps_percentile(double fraction) const;
+};
+
+// plays options.breaks breaks off the game's rack with a jittered cue spot,
+// aim and power, spread over the pool. each break's jitter comes from its
+// index, so the output is the same for any number of threads. results are
+// written one CSV row per break, a chunk at a time, so memory stays flat
+// however many breaks are asked for
+BreakSummary analyze_breaks(const BreakOptions& options, ThreadPool& pool, std::ostream& csv);
+
+void print_break_summary(const BreakSummary& summary, const Simulation& sim, std::ostream& out);
+
+#endif
@@ -0,0 +1,126 @@
+#include "contact_solver.h"
+
+#include <algorithm>
+#include <cmath>
+
+ContactOptions default_contact_options() {
+    ContactOptions options;
+    options.max_iterations = 32;
+    options.speed_tolerance = 1e-4f;
+    options.overlap_tolerance = 1e-3f;
+    return options;
+}
+
+ContactSolver::ContactSolver() : options(default_contact_options()), stats(), solves(0), unconverged(0) {}
+
+void ContactSolver::set_options(const ContactOptions& o) { options = o; }
+const ContactOptions& ContactSolver::get_options() const { return options; }
+const ContactStats& ContactSolver::get_stats() const { return stats; }
+long long ContactSolver::get_solves() const { return solves; }
+long long ContactSolver::get_unconverged() const { return unconverged; }
+
+int ContactSolver::root(int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+void ContactSolver::gather(const BallStore& balls, const std::vector<int>& moving,
+                           const std::vector<std::pair<int, int>>& candidates) {
+    const float reach = 2*BALL_RADIUS + CONTACT_MARGIN;
+
+    contacts.clear();
+    for (const std::pair<int, int>& pair : candidates) {
+        int i = pair.first, j = pair.second;
+        if (!balls.active[i] || !balls.active[j]) continue;
+
+        float nx = balls.x[j] - balls.x[i];
+        float ny = balls.y[j] - balls.y[i];
+        float dist_sq = nx*nx + ny*ny;
+        if (dist_sq > reach*reach) continue;
+        float dist = std::sqrt(dist_sq);
+        if (dist < 0.0001f) continue; // no normal, same as resolve_collision
+
+        bool touching = balls.check_collision(i, j);
+        contacts.push_back({i, j, nx / dist, ny / dist, touching});
+    }
+    std::sort(contacts.begin(), contacts.end(), [](const Contact& a, const Contact& b) {
+        return a.i != b.i ? a.i < b.i : a.j < b.j;
+    });
+
+    // keep the islands with something moving in them. roots are always the
+    // lowest id, so the grouping doesn't depend on the order either
+    parent.resize(balls.count);
+    for (int i=0; i<balls.count; ++i) parent[i] = i;
+    for (const Contact& c : contacts) {
+        int a = root(c.i), b = root(c.j);
+        if (a != b) parent[std::max(a, b)] = std::min(a, b);
+    }
+    keep.assign(balls.count, 0);
+    for (int i : moving) keep[root(i)] = 1;
+    contacts.erase(std::remove_if(contacts.begin(), contacts.end(),
+                                  [&](const Contact& c) { return !keep[root(c.i)]; }),
+                   contacts.end());
+}
+
+bool ContactSolver::solve_velocities(BallStore& balls) {
+    for (int it=0; it<options.max_iterations; ++it) {
+        bool applied = false;
+        for (const Contact& c : contacts) {
+            if (!c.touching) continue;
+            float dot = (balls.dx[c.i] - balls.dx[c.j])*c.nx + (balls.dy[c.i] - balls.dy[c.j])*c.ny;
+            if (dot <= options.speed_tolerance) continue;
+
+            balls.dx[c.i] -= dot * c.nx;
+            balls.dy[c.i] -= dot * c.ny;
+            balls.dx[c.j] += dot * c.nx;
+            balls.dy[c.j] += dot * c.ny;
+            stats.impulse += dot;
+            applied = true;
+        }
+        stats.velocity_iterations = it + 1;
+        if (!applied) return true;
+    }
+    return false;
+}
+
+bool ContactSolver::solve_overlaps(BallStore& balls) {
+    for (int it=0; it<options.max_iterations; ++it) {
+        bool pushed = false;
+        for (const Contact& c : contacts) {
+            float nx = balls.x[c.j] - balls.x[c.i];
+            float ny = balls.y[c.j] - balls.y[c.i];
+            float dist = std::sqrt(nx*nx + ny*ny);
+            if (dist < 0.0001f) continue;
+            float overlap = 2*BALL_RADIUS - dist;
+            if (overlap <= options.overlap_tolerance) continue;
+
+            float push = overlap / 2.0f / dist;
+            balls.x[c.i] -= push * nx;
+            balls.y[c.i] -= push * ny;
+            balls.x[c.j] += push * nx;
+            balls.y[c.j] += push * ny;
+            pushed = true;
+        }
+        stats.position_iterations = it + 1;
+        if (!pushed) return true;
+    }
+    return false;
+}
+
+const ContactStats& ContactSolver::solve(BallStore& balls, const std::vector<int>& moving,
+                                         const std::vector<std::pair<int, int>>& candidates) {
+    gather(balls, moving, candidates);
+
+    stats = ContactStats();
+    for (const Contact& c : contacts) stats.contacts += c.touching;
+    bool velocities = solve_velocities(balls);
+    bool overlaps = solve_overlaps(balls);
+    stats.converged = velocities && overlaps;
+
+    ++solves;
+    if (!stats.converged) ++unconverged;
+    return stats;
+}
@@ -0,0 +1,86 @@
+#ifndef CONTACT_SOLVER_H
+#define CONTACT_SOLVER_H
+
+#include "utility.h"
+#include "ball.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+enum class Contacts {
+    Sequential,   // each pair resolved as it's found, the original behaviour
+    Simultaneous, // every contact of a step gathered and solved together
+};
+
+// pairs this close are gathered too, so pushing one overlap apart rarely
+// opens another the same solve doesn't see. the grid's slack, anything
+// further may not be in neighbouring cells
+constexpr float CONTACT_MARGIN = 2.0f;
+
+struct ContactOptions {
+    int max_iterations;       // per pass, velocity and overlap each
+    float speed_tolerance;    // approach speed left over that counts as resolved, px/frame
+    float overlap_tolerance;  // px
+};
+
+ContactOptions default_contact_options();
+
+struct ContactStats {
+    int contacts; // touching pairs
+    int velocity_iterations;
+    int position_iterations;
+    float impulse; // total speed exchanged, px/frame
+    bool converged; // both passes finished inside max_iterations
+};
+
+// solves a step's contacts as one system instead of pair by pair as they
+// turn up. the contacts are put in id order first, so the result doesn't
+// depend on the order the broad phase found them in, and only contacts
+// connected to a moving ball through other contacts are kept, so the grid
+// and brute force gather exactly the same set.
+// the velocity pass sweeps the contacts applying the same elastic exchange
+// as BallStore::resolve_collision to any pair still approaching, and repeats
+// until none is, which carries an impact through a cluster in one step. the
+// overlap pass then pushes touching pairs apart, again repeating until every
+// pair is apart, so corrections settle rather than fight over later steps
+class ContactSolver {
+private:
+    struct Contact {
+        int i, j;      // i < j
+        float nx, ny;  // unit, i towards j, fixed when gathered
+        bool touching; // false when only within the margin, overlap pass alone
+    };
+
+    ContactOptions options;
+    std::vector<Contact> contacts;
+    std::vector<int> parent; // union-find over ball ids, for the island filter
+    std::vector<std::uint8_t> keep;
+    ContactStats stats;
+    long long solves, unconverged;
+
+    int root(int i);
+    void gather(const BallStore& balls, const std::vector<int>& moving,
+                const std::vector<std::pair<int, int>>& candidates);
+    // true when everything resolved before max_iterations
+    bool solve_velocities(BallStore& balls);
+    bool solve_overlaps(BallStore& balls);
+
+public:
+    ContactSolver();
+
+    void set_options(const ContactOptions& o);
+    const ContactOptions& get_options() const;
+
+    // candidates are pairs i < j in any order, any that aren't within
+    // CONTACT_MARGIN of touching are dropped. moving are the balls awake
+    // this step
+    const ContactStats& solve(BallStore& balls, const std::vector<int>& moving,
+                              const std::vector<std::pair<int, int>>& candidates);
+
+    const ContactStats& get_stats() const; // the last solve's
+    long long get_solves() const;
+    long long get_unconverged() const;
+};
+
+#endif
@@ -1,16 +1,24 @@
 
 #include "cue.h"
+#include <algorithm>
+#include <cmath>
 
-Cue::Cue() : position({0, 0}), length(100), angle(0), power(15.0f), show_guideline(false) {}
+Cue::Cue() : position({0, 0}), length(100), angle(0), power(15.0f), show_guideline(false), show_prediction(false) {}
 
 
 float Cue::getAngle() const { return angle; }
 float Cue::getPower() const { return power; }
 void Cue::setPower(float p) { power = p; }
 void Cue::toggle_guideline() { show_guideline = !show_guideline; }
+void Cue::toggle_prediction() { show_prediction = !show_prediction; }
+bool Cue::is_prediction_shown() const { return show_prediction; }
 
 void Cue::update(Position ball_pos, int mouse_x, int mouse_y) {
-    angle = std::atan2(mouse_y-ball_pos.y, mouse_x-ball_pos.x);
+    aim(ball_pos, std::atan2(mouse_y-ball_pos.y, mouse_x-ball_pos.x));
+}
+
+void Cue::aim(Position ball_pos, float a) {
+    angle = a;
     position = {ball_pos.x + std::cos(angle)*length, ball_pos.y + std::sin(angle)*length};
 }
 
@@ -20,7 +28,7 @@ void Cue::draw(SDL_Renderer* renderer, Position ball_pos) const {
 }
 
 
-void Cue::draw_guideline(SDL_Renderer* renderer, Position ball_pos, float ball_radius, int table_width, int table_height, const std::list<Ball>& balls) {
+void Cue::draw_guideline(SDL_Renderer* renderer, Position ball_pos, float ball_radius, int table_width, int table_height, const BallStore& balls) {
     if (!show_guideline) return;
 
     // main aiming guide (default and permanent), yellow, coming out of the ball
@@ -37,13 +45,15 @@ void Cue::draw_guideline(SDL_Renderer* renderer, Position ball_pos, float ball_r
     }
 
     float nearest_collision_dist = FLOAT_MAX;
-    const Ball* target_ball = nullptr;
+    int target_ball = -1;
     Position collision_point = {0, 0};
     Position cue_bounce = {0, 0};
     Position hit_ball_end = {0, 0};
 
-    for (const Ball& ball : balls) {
-        Position target_pos = ball.get_position();
+    for (int i=1; i<balls.count; ++i) {
+        if (!balls.active[i]) continue;
+
+        Position target_pos = balls.get_position(i);
         float rel_x = target_pos.x - ball_pos.x;
         float rel_y = target_pos.y - ball_pos.y;
         float projection = (rel_x*dx + rel_y*dy);
@@ -59,7 +69,7 @@ void Cue::draw_guideline(SDL_Renderer* renderer, Position ball_pos, float ball_r
             if (collision_dist < nearest_collision_dist) {
                 // now update the ball
                 nearest_collision_dist = collision_dist;
-                target_ball = &ball;
+                target_ball = i;
 
                 collision_point = {ball_pos.x + dx*collision_dist, ball_pos.y + dy*collision_dist};
 
@@ -87,7 +97,7 @@ void Cue::draw_guideline(SDL_Renderer* renderer, Position ball_pos, float ball_r
         }
     }
 
-    if (target_ball) {
+    if (target_ball != -1) {
         // draw collision path if we found a target ball
         SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255); // yellow
         SDL_RenderDrawLine(renderer, ball_pos.x, ball_pos.y, collision_point.x, collision_point.y);
@@ -98,7 +108,7 @@ void Cue::draw_guideline(SDL_Renderer* renderer, Position ball_pos, float ball_r
 
         // target ball trajectory
         SDL_SetRenderDrawColor(renderer, 0, 0, 255, 255); // blue
-        SDL_RenderDrawLine(renderer, target_ball->get_position().x, target_ball->get_position().y, hit_ball_end.x, hit_ball_end.y);
+        SDL_RenderDrawLine(renderer, balls.x[target_ball], balls.y[target_ball], hit_ball_end.x, hit_ball_end.y);
     } else {
         // clue ball is projected to bounce off of the wall
         float tMin = FLOAT_MAX,
@@ -139,3 +149,27 @@ void Cue::draw_guideline(SDL_Renderer* renderer, Position ball_pos, float ball_r
         }
     }
 }
+
+void Cue::draw_prediction(SDL_Renderer* renderer, const ShotPrediction& prediction) const {
+    // cue ball path, red if it ends in a scratch
+    if (prediction.scratch) SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
+    else SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);
+    for (size_t i=1; i<prediction.cue_path.size(); ++i) {
+        SDL_RenderDrawLine(renderer, prediction.cue_path[i-1].x, prediction.cue_path[i-1].y,
+                           prediction.cue_path[i].x, prediction.cue_path[i].y);
+    }
+
+    // first ball hit
+    SDL_SetRenderDrawColor(renderer, 0, 0, 255, 255); // blue
+    for (size_t i=1; i<prediction.hit_path.size(); ++i) {
+        SDL_RenderDrawLine(renderer, prediction.hit_path[i-1].x, prediction.hit_path[i-1].y,
+                           prediction.hit_path[i].x, prediction.hit_path[i].y);
+    }
+}
+
+void Cue::draw_hint(SDL_Renderer* renderer, Position ball_pos, float hint_angle, float hint_power) const {
+    float reach = length * hint_power / (FPS/3.0f);
+    SDL_SetRenderDrawColor(renderer, 255, 215, 0, 255); // gold
+    SDL_RenderDrawLine(renderer, ball_pos.x, ball_pos.y,
+                       ball_pos.x + std::cos(hint_angle)*reach, ball_pos.y + std::sin(hint_angle)*reach);
+}
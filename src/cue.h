@@ -4,8 +4,8 @@
 #include "utility.h"
 
 #include <SDL2/SDL.h>
-#include <list>
 #include "ball.h"
+#include "prediction.h"
 
 class Cue {
 private:
@@ -14,6 +14,7 @@ private:
     float angle;
     float power;
     bool show_guideline;
+    bool show_prediction;
 
 public:
     Cue();
@@ -21,11 +22,17 @@ public:
     float getPower() const;
     void setPower(float p);
     void toggle_guideline();
+    void toggle_prediction();
+    bool is_prediction_shown() const;
     void update(Position ball_pos, int mouse_x, int mouse_y);
+    void aim(Position ball_pos, float angle);
     void draw(SDL_Renderer* renderer, Position ball_pos) const;
     void draw_guideline(SDL_Renderer *renderer, Position ball_pos,
                         float ball_radius, int table_width, int table_height,
-                        const std::list<Ball> &balls);
+                        const BallStore &balls);
+    void draw_prediction(SDL_Renderer* renderer, const ShotPrediction& prediction) const;
+    // suggested shot, length scaled by power
+    void draw_hint(SDL_Renderer* renderer, Position ball_pos, float hint_angle, float hint_power) const;
 };
 
 #endif
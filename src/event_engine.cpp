@@ -0,0 +1,278 @@
+#include "event_engine.h"
+#include "grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+// v(t) = v0 * DECELERATION^t, so the distance covered per unit of starting
+// velocity is s(t) = (1 - e^(-k t)) / k, and never more than 1/k
+static const double DECAY = -std::log((double)DECELERATION);
+
+// normal speed below which touching balls count as resting, px/frame
+constexpr double CONTACT_EPSILON = 1e-6;
+
+static double travel(double t) { return (1 - std::exp(-DECAY*t)) / DECAY; }
+
+// inverse of travel, or infinity when the ball stops short of s
+static double time_to_travel(double s) {
+    double left = 1 - DECAY*s;
+    if (left <= 0) return std::numeric_limits<double>::infinity();
+    return -std::log(left) / DECAY;
+}
+
+EventEngine::EventEngine()
+    : pockets(nullptr), now(0), processed(0),
+      cols(std::ceil(TABLE_WIDTH / GRID_CELL_SIZE)),
+      rows(std::ceil(TABLE_HEIGHT / GRID_CELL_SIZE)),
+      cells(cols*rows) {}
+
+int EventEngine::get_events_processed() const { return processed; }
+
+void EventEngine::load(const BallStore& balls) {
+    x.assign(balls.x.begin(), balls.x.begin() + balls.count);
+    y.assign(balls.y.begin(), balls.y.begin() + balls.count);
+    vx.assign(balls.dx.begin(), balls.dx.begin() + balls.count);
+    vy.assign(balls.dy.begin(), balls.dy.begin() + balls.count);
+    active.assign(balls.active.begin(), balls.active.begin() + balls.count);
+    t0.assign(balls.count, 0.0);
+    version.assign(balls.count, 0);
+    events = {};
+    now = 0;
+
+    for (std::vector<int>& cell : cells) cell.clear();
+    cell_x.assign(balls.count, 0);
+    cell_y.assign(balls.count, 0);
+    for (int i=0; i<balls.count; ++i) {
+        if (!active[i]) continue;
+        cell_x[i] = std::clamp((int)(x[i] / GRID_CELL_SIZE), 0, cols-1);
+        cell_y[i] = std::clamp((int)(y[i] / GRID_CELL_SIZE), 0, rows-1);
+        cells[cell_y[i]*cols + cell_x[i]].push_back(i);
+    }
+}
+
+void EventEngine::store(BallStore& balls) {
+    for (int i=0; i<balls.count; ++i) {
+        rebase(i, now);
+        balls.x[i] = x[i];
+        balls.y[i] = y[i];
+        balls.dx[i] = vx[i];
+        balls.dy[i] = vy[i];
+    }
+}
+
+void EventEngine::rebase(int i, double time) {
+    double dt = time - t0[i];
+    t0[i] = time;
+    if (dt <= 0 || (vx[i] == 0 && vy[i] == 0)) return;
+
+    double s = travel(dt);
+    double decay = std::exp(-DECAY*dt);
+    x[i] += vx[i]*s;
+    y[i] += vy[i]*s;
+    vx[i] *= decay;
+    vy[i] *= decay;
+}
+
+void EventEngine::push(double s, EventType type, int a, int b) {
+    double dt = time_to_travel(std::max(s, 0.0));
+    if (std::isinf(dt)) return;
+    events.push({now + dt, type, a, b, version[a], type == BALL_HIT ? version[b] : 0});
+}
+
+void EventEngine::predict(int i) {
+    // a ball that has just stopped has no events of its own, but its version
+    // bump dropped the hits moving neighbours had queued on it, so it is
+    // still paired with them again
+    if (vx[i] != 0 || vy[i] != 0) predict_motion(i);
+
+    // any ball i can touch before changing cell is in the 3x3 around it
+    for (int ny = std::max(cell_y[i]-1, 0); ny <= std::min(cell_y[i]+1, rows-1); ++ny) {
+        for (int nx = std::max(cell_x[i]-1, 0); nx <= std::min(cell_x[i]+1, cols-1); ++nx) {
+            for (int j : cells[ny*cols + nx]) {
+                if (j != i) predict_pair(i, j);
+            }
+        }
+    }
+}
+
+// stops, cushions, pockets and cell exits of a moving ball
+void EventEngine::predict_motion(int i) {
+    // each axis stops once it decays below MIN_SPEED, as in BallStore::move
+    if (vx[i] != 0) {
+        double dt = std::max(std::log(std::fabs(vx[i]) / MIN_SPEED) / DECAY, 0.0);
+        events.push({now + dt, STOP_X, i, -1, version[i], 0});
+    }
+    if (vy[i] != 0) {
+        double dt = std::max(std::log(std::fabs(vy[i]) / MIN_SPEED) / DECAY, 0.0);
+        events.push({now + dt, STOP_Y, i, -1, version[i], 0});
+    }
+
+    if (vx[i] < 0) push((BALL_RADIUS - x[i]) / vx[i], CUSHION_X, i, -1);
+    if (vx[i] > 0) push((TABLE_WIDTH - BALL_RADIUS - x[i]) / vx[i], CUSHION_X, i, -1);
+    if (vy[i] < 0) push((BALL_RADIUS - y[i]) / vy[i], CUSHION_Y, i, -1);
+    if (vy[i] > 0) push((TABLE_HEIGHT - BALL_RADIUS - y[i]) / vy[i], CUSHION_Y, i, -1);
+
+    // this and predict_pair solve |p + v*s|^2 = r^2, taking the entering root
+    double a = vx[i]*vx[i] + vy[i]*vy[i];
+    for (int k=0; k<(int)pockets->size(); ++k) {
+        double px = x[i] - (*pockets)[k].x;
+        double py = y[i] - (*pockets)[k].y;
+        double b = 2*(px*vx[i] + py*vy[i]);
+        double c = px*px + py*py - POCKET_RADIUS*POCKET_RADIUS;
+        double disc = b*b - 4*a*c;
+
+        if (c <= 0) push(0, POCKET, i, k);
+        else if (b < 0 && disc >= 0) push((-b - std::sqrt(disc)) / (2*a), POCKET, i, k);
+    }
+
+    predict_cell_exit(i, true);
+    predict_cell_exit(i, false);
+}
+
+void EventEngine::predict_pair(int i, int j) {
+    rebase(j, now);
+
+    double px = x[i] - x[j];
+    double py = y[i] - y[j];
+    double rvx = vx[i] - vx[j];
+    double rvy = vy[i] - vy[j];
+    double ra = rvx*rvx + rvy*rvy;
+    double b = 2*(px*rvx + py*rvy);
+    // separating, or resting against each other. a touching pair closing
+    // at rounding-error speed would otherwise trade zero-time events forever
+    if (ra == 0 || -b < 2*CONTACT_EPSILON*std::sqrt(px*px + py*py)) return;
+
+    double c = px*px + py*py - 4*BALL_RADIUS*BALL_RADIUS;
+    double disc = b*b - 4*ra*c;
+    if (disc < 0) return;
+
+    push(c <= 0 ? 0 : (-b - std::sqrt(disc)) / (2*ra), BALL_HIT, i, j);
+}
+
+// when i's trajectory reaches the border of its cell on one axis
+void EventEngine::predict_cell_exit(int i, bool x_axis) {
+    double pos = x_axis ? x[i] : y[i];
+    double vel = x_axis ? vx[i] : vy[i];
+    int cell = x_axis ? cell_x[i] : cell_y[i];
+    int last = x_axis ? cols-1 : rows-1;
+    EventType type = x_axis ? CELL_X : CELL_Y;
+
+    if (vel > 0 && cell < last) push(((cell+1)*GRID_CELL_SIZE - pos) / vel, type, i, 1);
+    if (vel < 0 && cell > 0) push((cell*GRID_CELL_SIZE - pos) / vel, type, i, -1);
+}
+
+// the trajectory doesn't change, so i's queued events all stand. it only
+// needs pairing with the row or column of cells it now borders
+void EventEngine::enter_cell(int i, bool x_axis, int direction) {
+    std::vector<int>& from = cells[cell_y[i]*cols + cell_x[i]];
+    from.erase(std::find(from.begin(), from.end(), i));
+    if (x_axis) cell_x[i] += direction;
+    else cell_y[i] += direction;
+    cells[cell_y[i]*cols + cell_x[i]].push_back(i);
+
+    predict_cell_exit(i, x_axis);
+
+    int edge = (x_axis ? cell_x[i] : cell_y[i]) + direction;
+    if (edge < 0 || edge >= (x_axis ? cols : rows)) return;
+    int across = x_axis ? cell_y[i] : cell_x[i];
+    int across_last = x_axis ? rows-1 : cols-1;
+    for (int k = std::max(across-1, 0); k <= std::min(across+1, across_last); ++k) {
+        for (int j : cells[x_axis ? k*cols + edge : edge*cols + k]) predict_pair(i, j);
+    }
+}
+
+// same impulse exchange as BallStore::resolve_collision, minus the overlap
+// push since the balls meet exactly at contact
+void EventEngine::resolve_hit(int i, int j) {
+    double nx = x[j] - x[i];
+    double ny = y[j] - y[i];
+    double dist = std::sqrt(nx*nx + ny*ny);
+    if (dist < 0.0001) return;
+
+    nx /= dist;
+    ny /= dist;
+
+    double dot_prod = (vx[i] - vx[j])*nx + (vy[i] - vy[j])*ny;
+    if (dot_prod > 0) {
+        vx[i] -= dot_prod * nx;
+        vy[i] -= dot_prod * ny;
+        vx[j] += dot_prod * nx;
+        vy[j] += dot_prod * ny;
+    }
+}
+
+EventEngine::Advance EventEngine::advance(BallStore& balls, const std::vector<Position>& table_pockets, double max_time) {
+    pockets = &table_pockets;
+    processed = 0;
+    load(balls);
+
+    for (int i=0; i<balls.count; ++i) {
+        if (active[i]) predict(i);
+    }
+
+    while (!events.empty() && processed < MAX_EVENTS) {
+        Event event = events.top();
+        events.pop();
+
+        if (event.version_a != version[event.a]) continue;
+        if (event.type == BALL_HIT && event.version_b != version[event.b]) continue;
+
+        if (event.time > max_time) {
+            now = max_time;
+            break;
+        }
+        now = event.time;
+        ++processed;
+
+        int i = event.a;
+        rebase(i, now);
+        switch (event.type) {
+            case BALL_HIT:
+                rebase(event.b, now);
+                resolve_hit(i, event.b);
+                break;
+            case CUSHION_X:
+                x[i] = std::clamp(x[i], (double)BALL_RADIUS, TABLE_WIDTH - (double)BALL_RADIUS);
+                vx[i] = -vx[i];
+                break;
+            case CUSHION_Y:
+                y[i] = std::clamp(y[i], (double)BALL_RADIUS, TABLE_HEIGHT - (double)BALL_RADIUS);
+                vy[i] = -vy[i];
+                break;
+            case STOP_X:
+                vx[i] = 0;
+                break;
+            case STOP_Y:
+                vy[i] = 0;
+                break;
+            case POCKET:
+                // the ball stops on the pocket's edge, hand back the pocket
+                // the event predicted rather than looking it up from there
+                store(balls);
+                return {now, i, event.b, false};
+            case CELL_X:
+            case CELL_Y:
+                enter_cell(i, event.type == CELL_X, event.b);
+                continue;
+        }
+
+        ++version[i];
+        predict(i);
+        if (event.type == BALL_HIT) {
+            ++version[event.b];
+            predict(event.b);
+        }
+    }
+
+    // out of events with a valid one still queued, something is moving
+    bool cut_off = false;
+    while (processed >= MAX_EVENTS && !events.empty() && !cut_off) {
+        const Event& event = events.top();
+        cut_off = event.version_a == version[event.a] &&
+                  (event.type != BALL_HIT || event.version_b == version[event.b]);
+        events.pop();
+    }
+
+    store(balls);
+    return {now, -1, -1, cut_off};
+}
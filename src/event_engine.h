@@ -0,0 +1,80 @@
+#ifndef EVENT_ENGINE_H
+#define EVENT_ENGINE_H
+
+#include "utility.h"
+#include "ball.h"
+
+#include <functional>
+#include <queue>
+#include <vector>
+
+// give up after this many events in one advance, guards against zeno
+// clusters. Simulation steps the rest of a shot that runs out
+constexpr int MAX_EVENTS = 100000;
+
+// continuous-time alternative to frame stepping. between events every ball
+// follows the same exponential DECELERATION as BallStore::move, integrated
+// exactly, so the engine jumps straight to the next ball, cushion, pocket or
+// stop event instead of stepping every frame, and fast balls can't tunnel.
+// balls are kept in grid cells and only paired with the 3x3 cells around
+// them, crossing into a new cell is an event of its own that pairs the ball
+// with what it now borders. time is in 60 Hz frames
+class EventEngine {
+private:
+    enum EventType { BALL_HIT, CUSHION_X, CUSHION_Y, POCKET, STOP_X, STOP_Y, CELL_X, CELL_Y };
+
+    struct Event {
+        double time;
+        EventType type;
+        // b is the other ball of a BALL_HIT, the pocket index of a POCKET
+        // and the direction, -1 or 1, of a CELL_X or CELL_Y
+        int a, b;
+        int version_a, version_b;
+
+        bool operator>(const Event& other) const { return time > other.time; }
+    };
+
+    // trajectory of ball i is (x, y) + (vx, vy)*s(t - t0)
+    std::vector<double> x, y, vx, vy, t0;
+    std::vector<std::uint8_t> active;
+    // bumped every time a ball's trajectory changes, staler events are dropped
+    std::vector<int> version;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    const std::vector<Position>* pockets;
+    double now;
+    int processed;
+
+    // balls per cell, and the cell each ball is in, moved only by CELL_X and
+    // CELL_Y so a ball sitting on a border can't flicker between cells
+    int cols, rows;
+    std::vector<std::vector<int>> cells;
+    std::vector<int> cell_x, cell_y;
+
+    void load(const BallStore& balls);
+    void store(BallStore& balls);
+    void rebase(int i, double time);
+    void push(double s, EventType type, int a, int b);
+    void predict(int i);
+    void predict_motion(int i);
+    void predict_pair(int i, int j);
+    void predict_cell_exit(int i, bool x_axis);
+    void enter_cell(int i, bool x_axis, int direction);
+    void resolve_hit(int i, int j);
+
+public:
+    struct Advance {
+        double time;
+        int pocketed; // ball id, or -1 at rest or out of time
+        int pocket; // index into pockets it dropped in, -1 with pocketed
+        bool cut_off; // MAX_EVENTS ran out with balls still moving
+    };
+
+    EventEngine();
+
+    // run the balls forward at most max_time frames. stops early when a ball
+    // drops so the caller can score it and call again
+    Advance advance(BallStore& balls, const std::vector<Position>& pockets, double max_time);
+    int get_events_processed() const;
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "frame_export.h"
+
+#include <csignal>
+#include <cstring>
+#include <iostream>
+
+FrameExporter::FrameExporter()
+    : file(nullptr), piped(false), width(0), height(0), closing(false), failed(false), frames(0) {}
+
+FrameExporter::~FrameExporter() { close(); }
+
+bool FrameExporter::open(const std::string& target, int w, int h) {
+    if (target == "-") {
+        file = stdout;
+    } else if (!target.empty() && target[0] == '|') {
+        file = popen(target.c_str() + 1, "w");
+        piped = true;
+    } else {
+        file = std::fopen(target.c_str(), "wb");
+    }
+    if (!file) {
+        std::cerr << "Export Error: could not open " << target << "\n";
+        return false;
+    }
+    // an encoder that quits early should fail the next write, not kill us
+    std::signal(SIGPIPE, SIG_IGN);
+
+    width = w;
+    height = h;
+    buffers.assign(EXPORT_POOL_SIZE, std::vector<std::uint8_t>((size_t)w * h * 4));
+    for (int i=0; i<EXPORT_POOL_SIZE; ++i) free_buffers.push(i);
+    writer = std::thread(&FrameExporter::write_loop, this);
+    return true;
+}
+
+void FrameExporter::write_loop() {
+    while (true) {
+        int id = -1;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return filled.pop(id) || closing; });
+            if (id < 0) return; // closing, and everything is written
+        }
+
+        const std::vector<std::uint8_t>& frame = buffers[id];
+        if (!failed && std::fwrite(frame.data(), 1, frame.size(), file) != frame.size()) failed = true;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            free_buffers.push(id);
+        }
+        changed.notify_all();
+    }
+}
+
+bool FrameExporter::submit(const void* pixels, int pitch) {
+    if (!file || failed) return false;
+
+    int id;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return free_buffers.pop(id); });
+    }
+
+    size_t row = (size_t)width * 4;
+    const std::uint8_t* src = (const std::uint8_t*)pixels;
+    std::uint8_t* dst = buffers[id].data();
+    for (int y=0; y<height; ++y) std::memcpy(dst + y*row, src + (size_t)y*pitch, row);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        filled.push(id);
+    }
+    changed.notify_all();
+    ++frames;
+    return !failed;
+}
+
+void FrameExporter::close() {
+    if (!file) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+    }
+    changed.notify_all();
+    if (writer.joinable()) writer.join();
+
+    if (piped) pclose(file);
+    else if (file == stdout) std::fflush(file);
+    else std::fclose(file);
+    file = nullptr;
+}
+
+long long FrameExporter::get_frames() const { return frames; }
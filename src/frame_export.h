@@ -0,0 +1,57 @@
+#ifndef FRAME_EXPORT_H
+#define FRAME_EXPORT_H
+
+#include "spsc_queue.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// frames in flight between the renderer and the writer
+constexpr int EXPORT_POOL_SIZE = 8;
+
+// writes raw rgba frames, tightly packed rows, to a file, stdout ("-") or a
+// command's stdin ("|ffmpeg ..."). buffers come from a fixed pool and writing
+// happens on its own thread, so a frame costs one copy and no allocation,
+// and rendering only waits when the pipe falls a whole pool behind
+class FrameExporter {
+private:
+    FILE* file;
+    bool piped;
+    int width, height;
+    std::vector<std::vector<std::uint8_t>> buffers;
+
+    // buffer ids, handed back and forth between the two threads
+    SpscQueue<int, EXPORT_POOL_SIZE> free_buffers;
+    SpscQueue<int, EXPORT_POOL_SIZE> filled;
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool closing;
+    // set by the writer, read by submit without the lock
+    std::atomic<bool> failed;
+
+    std::thread writer;
+    long long frames;
+
+    void write_loop();
+
+public:
+    FrameExporter();
+    ~FrameExporter();
+
+    bool open(const std::string& target, int width, int height);
+    // copies the frame out of pixels, rows pitch bytes apart. false once a
+    // write has failed, say the encoder on the other end exited
+    bool submit(const void* pixels, int pitch);
+    // waits for everything submitted to be written
+    void close();
+
+    long long get_frames() const;
+};
+
+#endif
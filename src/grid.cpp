@@ -0,0 +1,111 @@
+#include "grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+BroadPhaseGrid::BroadPhaseGrid()
+    : cols(std::ceil(TABLE_WIDTH / GRID_CELL_SIZE)),
+      rows(std::ceil(TABLE_HEIGHT / GRID_CELL_SIZE)),
+      cell_head(cols*rows, -1) {}
+
+int BroadPhaseGrid::cell_of(float x, float y) const {
+    int cx = std::clamp((int)(x / GRID_CELL_SIZE), 0, cols-1);
+    int cy = std::clamp((int)(y / GRID_CELL_SIZE), 0, rows-1);
+    return cy*cols + cx;
+}
+
+void BroadPhaseGrid::link(int ball, int cell) {
+    prev[ball] = -1;
+    next[ball] = cell_head[cell];
+    if (cell_head[cell] != -1) prev[cell_head[cell]] = ball;
+    cell_head[cell] = ball;
+    ball_cell[ball] = cell;
+}
+
+void BroadPhaseGrid::unlink(int ball) {
+    int cell = ball_cell[ball];
+    if (cell == -1) return;
+
+    if (prev[ball] != -1) next[prev[ball]] = next[ball];
+    else cell_head[cell] = next[ball];
+    if (next[ball] != -1) prev[next[ball]] = prev[ball];
+    ball_cell[ball] = -1;
+}
+
+void BroadPhaseGrid::clear() {
+    std::fill(cell_head.begin(), cell_head.end(), -1);
+    std::fill(ball_cell.begin(), ball_cell.end(), -1);
+}
+
+void BroadPhaseGrid::update(const BallStore& balls) {
+    if ((int)ball_cell.size() < balls.capacity()) {
+        next.resize(balls.capacity());
+        prev.resize(balls.capacity());
+        ball_cell.resize(balls.capacity());
+        clear();
+    }
+
+    for (int i=0; i<(int)ball_cell.size(); ++i) {
+        if (i >= balls.count || !balls.active[i]) {
+            unlink(i);
+            continue;
+        }
+
+        int cell = cell_of(balls.x[i], balls.y[i]);
+        if (cell != ball_cell[i]) {
+            unlink(i);
+            link(i, cell);
+        }
+    }
+}
+
+void BroadPhaseGrid::find_pairs(const BallStore& balls, const std::vector<int>& moving,
+                                std::vector<std::pair<int, int>>& pairs, bool through_resting) {
+    pairs.clear();
+    visited.assign(balls.count, 0);
+    island.assign(moving.begin(), moving.end());
+    for (int i : moving) visited[i] = 1;
+
+    // 0 unseen, 1 queued, 2 done. pairs with a done ball were already added
+    for (size_t k=0; k<island.size(); ++k) {
+        int i = island[k];
+        int cell = ball_cell[i];
+        visited[i] = 2;
+        if (cell == -1) continue;
+
+        int cx = cell % cols;
+        int cy = cell / cols;
+        for (int ny = std::max(cy-1, 0); ny <= std::min(cy+1, rows-1); ++ny) {
+            for (int nx = std::max(cx-1, 0); nx <= std::min(cx+1, cols-1); ++nx) {
+                for (int j = cell_head[ny*cols + nx]; j != -1; j = next[j]) {
+                    if (j == i || visited[j] == 2) continue;
+                    pairs.push_back({std::min(i, j), std::max(i, j)});
+
+                    // the solver pushes through resting chains on this step
+                    if (through_resting && !visited[j]) {
+                        visited[j] = 1;
+                        island.push_back(j);
+                    }
+                }
+            }
+        }
+    }
+
+    // same order as the brute force loop so both paths resolve alike
+    std::sort(pairs.begin(), pairs.end());
+}
+
+void BroadPhaseGrid::neighbour_pairs(int ball, std::vector<std::pair<int, int>>& pairs) const {
+    int cell = ball_cell[ball];
+    if (cell == -1) return;
+
+    int cx = cell % cols;
+    int cy = cell / cols;
+    for (int ny = std::max(cy-1, 0); ny <= std::min(cy+1, rows-1); ++ny) {
+        for (int nx = std::max(cx-1, 0); nx <= std::min(cx+1, cols-1); ++nx) {
+            for (int j = cell_head[ny*cols + nx]; j != -1; j = next[j]) {
+                if (j != ball) pairs.push_back({std::min(ball, j), std::max(ball, j)});
+            }
+        }
+    }
+}
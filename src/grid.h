@@ -0,0 +1,49 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include "utility.h"
+#include "ball.h"
+
+#include <utility>
+#include <vector>
+
+// one ball diameter, so any touching pair is within the 3x3 neighbourhood,
+// plus slack for balls pushed into contact by earlier overlap corrections
+constexpr float GRID_CELL_SIZE = 2*BALL_RADIUS + 2.0f;
+
+// uniform grid broad phase over the table. each cell is an intrusive doubly
+// linked list of ball ids, so a ball changing cell is an O(1) relink and the
+// grid is updated incrementally instead of rebuilt every frame
+class BroadPhaseGrid {
+private:
+    int cols, rows;
+    std::vector<int> cell_head;
+    std::vector<int> next, prev;
+    std::vector<int> ball_cell;
+
+    // scratch for the awake walk
+    std::vector<std::uint8_t> visited;
+    std::vector<int> island;
+
+    int cell_of(float x, float y) const;
+    void link(int ball, int cell);
+    void unlink(int ball);
+
+public:
+    BroadPhaseGrid();
+
+    void clear();
+    void update(const BallStore& balls);
+    // candidate pairs (i < j) from neighbouring cells, sorted in id order.
+    // every pair has a moving ball in it, two resting balls are never
+    // paired. through_resting carries the walk on through resting
+    // neighbours instead, so each cluster a moving ball touches comes back
+    // whole, resting pairs and all, for the contact solver
+    void find_pairs(const BallStore& balls, const std::vector<int>& moving,
+                    std::vector<std::pair<int, int>>& pairs, bool through_resting = false);
+    // appends the pairs of ball with everything in its neighbouring cells,
+    // for a ball knocked from rest after find_pairs ran
+    void neighbour_pairs(int ball, std::vector<std::pair<int, int>>& pairs) const;
+};
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef HUD_FONT_H
+#define HUD_FONT_H
+
+#include <cstdint>
+
+constexpr char FIRST_GLYPH = ' ';
+constexpr char LAST_GLYPH = '~';
+constexpr int GLYPH_COUNT = LAST_GLYPH - FIRST_GLYPH + 1;
+
+// the built in hud font, 5x7 pixel glyphs with two more rows below the
+// baseline for descenders. compiled in, so drawing text needs no font file
+// and nothing has to be parsed at startup
+constexpr int HUD_GLYPH_COLUMNS = 5;
+constexpr int HUD_GLYPH_ROWS = 9;
+constexpr int HUD_FONT_SCALE = 2;
+// each glyph's cell in the atlas, scaled glyph plus padding. also the advance
+constexpr int HUD_CELL_W = 12;
+constexpr int HUD_CELL_H = 20;
+
+// rows top down, bit 4 is the leftmost column
+extern const std::uint8_t HUD_FONT[GLYPH_COUNT][HUD_GLYPH_ROWS];
+
+#endif
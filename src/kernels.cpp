@@ -0,0 +1,320 @@
+#include "kernels.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KERNELS_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+constexpr float CONTACT_DIST_SQ = (2*BALL_RADIUS)*(2*BALL_RADIUS);
+
+KernelPath resolve_kernel_path(KernelPath requested) {
+#if defined(KERNELS_X86)
+    bool has_avx2 = __builtin_cpu_supports("avx2");
+    if (requested == KernelPath::Auto) return has_avx2 ? KernelPath::AVX2 : KernelPath::SSE;
+    if (requested == KernelPath::AVX2 && !has_avx2) return KernelPath::SSE;
+    if (requested == KernelPath::NEON) return KernelPath::Scalar;
+#elif defined(__ARM_NEON)
+    if (requested == KernelPath::Auto) return KernelPath::NEON;
+    if (requested == KernelPath::SSE || requested == KernelPath::AVX2) return KernelPath::Scalar;
+#else
+    if (requested != KernelPath::Scalar) return KernelPath::Scalar;
+#endif
+    return requested;
+}
+
+const char* kernel_path_name(KernelPath path) {
+    switch (path) {
+        case KernelPath::Auto: return "auto";
+        case KernelPath::Scalar: return "scalar";
+        case KernelPath::SSE: return "sse";
+        case KernelPath::AVX2: return "avx2";
+        case KernelPath::NEON: return "neon";
+    }
+    return "unknown";
+}
+
+static void integrate_scalar(BallStore& balls, int begin, float dt, float damping) {
+    for (int i=begin; i<balls.count; ++i) {
+        if (balls.active[i] && balls.is_moving(i)) balls.move(i, dt, damping);
+    }
+}
+
+static int find_contact_scalar(const BallStore& balls, int i, int begin, int end) {
+    for (int j=begin; j<end; ++j) {
+        if (balls.active[j] && balls.check_collision(i, j)) return j;
+    }
+    return end;
+}
+
+#if defined(KERNELS_X86)
+
+// widen four active bytes into a per-lane all-ones mask
+static inline __m128 active_mask_sse(const std::uint8_t* active) {
+    int packed;
+    std::memcpy(&packed, active, 4);
+    __m128i bytes = _mm_cvtsi32_si128(packed);
+    __m128i zero = _mm_setzero_si128();
+    __m128i lanes = _mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero);
+    return _mm_castsi128_ps(_mm_xor_si128(_mm_cmpeq_epi32(lanes, zero), _mm_set1_epi32(-1)));
+}
+
+static inline __m128 select_sse(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static void integrate_sse(BallStore& balls, float dt, float damping) {
+    const __m128 step = _mm_set1_ps(dt);
+    const __m128 decel = _mm_set1_ps(damping);
+    const __m128 min_speed = _mm_set1_ps(MIN_SPEED);
+    const __m128 radius = _mm_set1_ps(BALL_RADIUS);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 width = _mm_set1_ps(TABLE_WIDTH);
+    const __m128 height = _mm_set1_ps(TABLE_HEIGHT);
+    const __m128 max_x = _mm_set1_ps((float)TABLE_WIDTH - BALL_RADIUS);
+    const __m128 max_y = _mm_set1_ps((float)TABLE_HEIGHT - BALL_RADIUS);
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+
+    int i = 0;
+    for (; i+4 <= balls.count; i += 4) {
+        __m128 x0 = _mm_loadu_ps(&balls.x[i]);
+        __m128 y0 = _mm_loadu_ps(&balls.y[i]);
+        __m128 dx0 = _mm_loadu_ps(&balls.dx[i]);
+        __m128 dy0 = _mm_loadu_ps(&balls.dy[i]);
+        __m128 moving = _mm_or_ps(_mm_cmpneq_ps(dx0, zero), _mm_cmpneq_ps(dy0, zero));
+        __m128 active = _mm_and_ps(active_mask_sse(&balls.active[i]), moving);
+
+        __m128 x = _mm_add_ps(x0, _mm_mul_ps(dx0, step));
+        __m128 y = _mm_add_ps(y0, _mm_mul_ps(dy0, step));
+        __m128 dx = _mm_mul_ps(dx0, decel);
+        __m128 dy = _mm_mul_ps(dy0, decel);
+
+        // trunc velocities to near-zero
+        dx = _mm_andnot_ps(_mm_cmplt_ps(_mm_and_ps(dx, abs_mask), min_speed), dx);
+        dy = _mm_andnot_ps(_mm_cmplt_ps(_mm_and_ps(dy, abs_mask), min_speed), dy);
+
+        // bounce off table edges
+        __m128 bounce_x = _mm_or_ps(_mm_cmplt_ps(_mm_sub_ps(x, radius), zero), _mm_cmpgt_ps(_mm_add_ps(x, radius), width));
+        __m128 bounce_y = _mm_or_ps(_mm_cmplt_ps(_mm_sub_ps(y, radius), zero), _mm_cmpgt_ps(_mm_add_ps(y, radius), height));
+        dx = _mm_xor_ps(dx, _mm_and_ps(bounce_x, sign_mask));
+        dy = _mm_xor_ps(dy, _mm_and_ps(bounce_y, sign_mask));
+
+        x = _mm_max_ps(_mm_min_ps(x, max_x), radius);
+        y = _mm_max_ps(_mm_min_ps(y, max_y), radius);
+
+        _mm_storeu_ps(&balls.x[i], select_sse(active, x, x0));
+        _mm_storeu_ps(&balls.y[i], select_sse(active, y, y0));
+        _mm_storeu_ps(&balls.dx[i], select_sse(active, dx, dx0));
+        _mm_storeu_ps(&balls.dy[i], select_sse(active, dy, dy0));
+    }
+    integrate_scalar(balls, i, dt, damping);
+}
+
+static int find_contact_sse(const BallStore& balls, int i, int begin, int end) {
+    const __m128 xi = _mm_set1_ps(balls.x[i]);
+    const __m128 yi = _mm_set1_ps(balls.y[i]);
+    const __m128 contact = _mm_set1_ps(CONTACT_DIST_SQ);
+
+    int j = begin;
+    for (; j+4 <= end; j += 4) {
+        __m128 dist_x = _mm_sub_ps(xi, _mm_loadu_ps(&balls.x[j]));
+        __m128 dist_y = _mm_sub_ps(yi, _mm_loadu_ps(&balls.y[j]));
+        __m128 dist_sq = _mm_add_ps(_mm_mul_ps(dist_x, dist_x), _mm_mul_ps(dist_y, dist_y));
+        __m128 hit = _mm_and_ps(_mm_cmple_ps(dist_sq, contact), active_mask_sse(&balls.active[j]));
+
+        int bits = _mm_movemask_ps(hit);
+        if (bits) return j + __builtin_ctz(bits);
+    }
+    return find_contact_scalar(balls, i, j, end);
+}
+
+__attribute__((target("avx2")))
+static inline __m256 active_mask_avx2(const std::uint8_t* active) {
+    __m256i lanes = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)active));
+    __m256i zero = _mm256_setzero_si256();
+    return _mm256_castsi256_ps(_mm256_xor_si256(_mm256_cmpeq_epi32(lanes, zero), _mm256_set1_epi32(-1)));
+}
+
+__attribute__((target("avx2")))
+static void integrate_avx2(BallStore& balls, float dt, float damping) {
+    const __m256 step = _mm256_set1_ps(dt);
+    const __m256 decel = _mm256_set1_ps(damping);
+    const __m256 min_speed = _mm256_set1_ps(MIN_SPEED);
+    const __m256 radius = _mm256_set1_ps(BALL_RADIUS);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 width = _mm256_set1_ps(TABLE_WIDTH);
+    const __m256 height = _mm256_set1_ps(TABLE_HEIGHT);
+    const __m256 max_x = _mm256_set1_ps((float)TABLE_WIDTH - BALL_RADIUS);
+    const __m256 max_y = _mm256_set1_ps((float)TABLE_HEIGHT - BALL_RADIUS);
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256 sign_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x80000000));
+
+    int i = 0;
+    for (; i+8 <= balls.count; i += 8) {
+        __m256 x0 = _mm256_loadu_ps(&balls.x[i]);
+        __m256 y0 = _mm256_loadu_ps(&balls.y[i]);
+        __m256 dx0 = _mm256_loadu_ps(&balls.dx[i]);
+        __m256 dy0 = _mm256_loadu_ps(&balls.dy[i]);
+        __m256 moving = _mm256_or_ps(_mm256_cmp_ps(dx0, zero, _CMP_NEQ_UQ), _mm256_cmp_ps(dy0, zero, _CMP_NEQ_UQ));
+        __m256 active = _mm256_and_ps(active_mask_avx2(&balls.active[i]), moving);
+
+        __m256 x = _mm256_add_ps(x0, _mm256_mul_ps(dx0, step));
+        __m256 y = _mm256_add_ps(y0, _mm256_mul_ps(dy0, step));
+        __m256 dx = _mm256_mul_ps(dx0, decel);
+        __m256 dy = _mm256_mul_ps(dy0, decel);
+
+        // trunc velocities to near-zero
+        dx = _mm256_andnot_ps(_mm256_cmp_ps(_mm256_and_ps(dx, abs_mask), min_speed, _CMP_LT_OQ), dx);
+        dy = _mm256_andnot_ps(_mm256_cmp_ps(_mm256_and_ps(dy, abs_mask), min_speed, _CMP_LT_OQ), dy);
+
+        // bounce off table edges
+        __m256 bounce_x = _mm256_or_ps(_mm256_cmp_ps(_mm256_sub_ps(x, radius), zero, _CMP_LT_OQ),
+                                       _mm256_cmp_ps(_mm256_add_ps(x, radius), width, _CMP_GT_OQ));
+        __m256 bounce_y = _mm256_or_ps(_mm256_cmp_ps(_mm256_sub_ps(y, radius), zero, _CMP_LT_OQ),
+                                       _mm256_cmp_ps(_mm256_add_ps(y, radius), height, _CMP_GT_OQ));
+        dx = _mm256_xor_ps(dx, _mm256_and_ps(bounce_x, sign_mask));
+        dy = _mm256_xor_ps(dy, _mm256_and_ps(bounce_y, sign_mask));
+
+        x = _mm256_max_ps(_mm256_min_ps(x, max_x), radius);
+        y = _mm256_max_ps(_mm256_min_ps(y, max_y), radius);
+
+        _mm256_storeu_ps(&balls.x[i], _mm256_blendv_ps(x0, x, active));
+        _mm256_storeu_ps(&balls.y[i], _mm256_blendv_ps(y0, y, active));
+        _mm256_storeu_ps(&balls.dx[i], _mm256_blendv_ps(dx0, dx, active));
+        _mm256_storeu_ps(&balls.dy[i], _mm256_blendv_ps(dy0, dy, active));
+    }
+    integrate_scalar(balls, i, dt, damping);
+}
+
+__attribute__((target("avx2")))
+static int find_contact_avx2(const BallStore& balls, int i, int begin, int end) {
+    const __m256 xi = _mm256_set1_ps(balls.x[i]);
+    const __m256 yi = _mm256_set1_ps(balls.y[i]);
+    const __m256 contact = _mm256_set1_ps(CONTACT_DIST_SQ);
+
+    int j = begin;
+    for (; j+8 <= end; j += 8) {
+        __m256 dist_x = _mm256_sub_ps(xi, _mm256_loadu_ps(&balls.x[j]));
+        __m256 dist_y = _mm256_sub_ps(yi, _mm256_loadu_ps(&balls.y[j]));
+        __m256 dist_sq = _mm256_add_ps(_mm256_mul_ps(dist_x, dist_x), _mm256_mul_ps(dist_y, dist_y));
+        __m256 hit = _mm256_and_ps(_mm256_cmp_ps(dist_sq, contact, _CMP_LE_OQ), active_mask_avx2(&balls.active[j]));
+
+        int bits = _mm256_movemask_ps(hit);
+        if (bits) return j + __builtin_ctz(bits);
+    }
+    return find_contact_sse(balls, i, j, end);
+}
+
+#endif
+
+#if defined(__ARM_NEON)
+
+static inline uint32x4_t active_mask_neon(const std::uint8_t* active) {
+    std::uint32_t packed;
+    std::memcpy(&packed, active, 4);
+    uint8x8_t bytes = vreinterpret_u8_u32(vdup_n_u32(packed));
+    uint32x4_t lanes = vmovl_u16(vget_low_u16(vmovl_u8(bytes)));
+    return vmvnq_u32(vceqq_u32(lanes, vdupq_n_u32(0)));
+}
+
+static void integrate_neon(BallStore& balls, float dt, float damping) {
+    const float32x4_t step = vdupq_n_f32(dt);
+    const float32x4_t decel = vdupq_n_f32(damping);
+    const float32x4_t min_speed = vdupq_n_f32(MIN_SPEED);
+    const float32x4_t radius = vdupq_n_f32(BALL_RADIUS);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t width = vdupq_n_f32(TABLE_WIDTH);
+    const float32x4_t height = vdupq_n_f32(TABLE_HEIGHT);
+    const float32x4_t max_x = vdupq_n_f32((float)TABLE_WIDTH - BALL_RADIUS);
+    const float32x4_t max_y = vdupq_n_f32((float)TABLE_HEIGHT - BALL_RADIUS);
+    const uint32x4_t sign_mask = vdupq_n_u32(0x80000000);
+
+    int i = 0;
+    for (; i+4 <= balls.count; i += 4) {
+        float32x4_t x0 = vld1q_f32(&balls.x[i]);
+        float32x4_t y0 = vld1q_f32(&balls.y[i]);
+        float32x4_t dx0 = vld1q_f32(&balls.dx[i]);
+        float32x4_t dy0 = vld1q_f32(&balls.dy[i]);
+        uint32x4_t resting = vandq_u32(vceqq_f32(dx0, zero), vceqq_f32(dy0, zero));
+        uint32x4_t active = vbicq_u32(active_mask_neon(&balls.active[i]), resting);
+
+        float32x4_t x = vaddq_f32(x0, vmulq_f32(dx0, step));
+        float32x4_t y = vaddq_f32(y0, vmulq_f32(dy0, step));
+        float32x4_t dx = vmulq_f32(dx0, decel);
+        float32x4_t dy = vmulq_f32(dy0, decel);
+
+        // trunc velocities to near-zero
+        dx = vbslq_f32(vcltq_f32(vabsq_f32(dx), min_speed), zero, dx);
+        dy = vbslq_f32(vcltq_f32(vabsq_f32(dy), min_speed), zero, dy);
+
+        // bounce off table edges
+        uint32x4_t bounce_x = vorrq_u32(vcltq_f32(vsubq_f32(x, radius), zero), vcgtq_f32(vaddq_f32(x, radius), width));
+        uint32x4_t bounce_y = vorrq_u32(vcltq_f32(vsubq_f32(y, radius), zero), vcgtq_f32(vaddq_f32(y, radius), height));
+        dx = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(dx), vandq_u32(bounce_x, sign_mask)));
+        dy = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(dy), vandq_u32(bounce_y, sign_mask)));
+
+        // select rather than vmin/vmax so the clamp matches std::clamp exactly
+        x = vbslq_f32(vcgtq_f32(x, max_x), max_x, x);
+        x = vbslq_f32(vcltq_f32(x, radius), radius, x);
+        y = vbslq_f32(vcgtq_f32(y, max_y), max_y, y);
+        y = vbslq_f32(vcltq_f32(y, radius), radius, y);
+
+        vst1q_f32(&balls.x[i], vbslq_f32(active, x, x0));
+        vst1q_f32(&balls.y[i], vbslq_f32(active, y, y0));
+        vst1q_f32(&balls.dx[i], vbslq_f32(active, dx, dx0));
+        vst1q_f32(&balls.dy[i], vbslq_f32(active, dy, dy0));
+    }
+    integrate_scalar(balls, i, dt, damping);
+}
+
+static int find_contact_neon(const BallStore& balls, int i, int begin, int end) {
+    const float32x4_t xi = vdupq_n_f32(balls.x[i]);
+    const float32x4_t yi = vdupq_n_f32(balls.y[i]);
+    const float32x4_t contact = vdupq_n_f32(CONTACT_DIST_SQ);
+
+    int j = begin;
+    for (; j+4 <= end; j += 4) {
+        float32x4_t dist_x = vsubq_f32(xi, vld1q_f32(&balls.x[j]));
+        float32x4_t dist_y = vsubq_f32(yi, vld1q_f32(&balls.y[j]));
+        float32x4_t dist_sq = vaddq_f32(vmulq_f32(dist_x, dist_x), vmulq_f32(dist_y, dist_y));
+        uint32x4_t hit = vandq_u32(vcleq_f32(dist_sq, contact), active_mask_neon(&balls.active[j]));
+
+        uint32x2_t any = vorr_u32(vget_low_u32(hit), vget_high_u32(hit));
+        if (vget_lane_u32(vpmax_u32(any, any), 0)) return find_contact_scalar(balls, i, j, j+4);
+    }
+    return find_contact_scalar(balls, i, j, end);
+}
+
+#endif
+
+void integrate_balls(BallStore& balls, KernelPath path, float dt, float damping) {
+    switch (path) {
+#if defined(KERNELS_X86)
+        case KernelPath::SSE: integrate_sse(balls, dt, damping); return;
+        case KernelPath::AVX2: integrate_avx2(balls, dt, damping); return;
+#endif
+#if defined(__ARM_NEON)
+        case KernelPath::NEON: integrate_neon(balls, dt, damping); return;
+#endif
+        default: integrate_scalar(balls, 0, dt, damping); return;
+    }
+}
+
+int find_contact(const BallStore& balls, int i, int begin, int end, KernelPath path) {
+    switch (path) {
+#if defined(KERNELS_X86)
+        case KernelPath::SSE: return find_contact_sse(balls, i, begin, end);
+        case KernelPath::AVX2: return find_contact_avx2(balls, i, begin, end);
+#endif
+#if defined(__ARM_NEON)
+        case KernelPath::NEON: return find_contact_neon(balls, i, begin, end);
+#endif
+        default: return find_contact_scalar(balls, i, begin, end);
+    }
+}
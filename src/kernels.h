@@ -0,0 +1,27 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "ball.h"
+
+// vectorized versions of BallStore::move and check_collision over every slot.
+// each lane does exactly the scalar float ops in the same order (no fma), so
+// all paths give bit-identical results
+enum class KernelPath {
+    Auto,
+    Scalar,
+    SSE,
+    AVX2,
+    NEON,
+};
+
+// Auto picks the widest path the cpu supports, unsupported paths fall back
+KernelPath resolve_kernel_path(KernelPath requested);
+const char* kernel_path_name(KernelPath path);
+
+// move every active ball one step of dt frames, see BallStore::move. resting
+// balls are left exactly as they are, same as moving only the awake ones
+void integrate_balls(BallStore& balls, KernelPath path, float dt = 1.0f, float damping = DECELERATION);
+// first active j in [begin, end) touching ball i, or end if there is none
+int find_contact(const BallStore& balls, int i, int begin, int end, KernelPath path);
+
+#endif
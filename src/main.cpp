@@ -1,7 +1,145 @@
 #include "table.h"
+#include "replay.h"
+#include "break_analysis.h"
 
-int main() {
-    Table table;
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    int physics_hz = FPS;
+    Game game = Game::NineBall;
+    Contacts contacts = Contacts::Sequential;
+    std::string record_path, replay_path, check_path, trace_path, analyze_path, export_path, font_path;
+    bool export_motion = false;
+    bool low_latency = false;
+    long long analyze_breaks_count = -1;
+    std::vector<std::string> stream_targets;
+    int spectate_port = 0;
+
+    for (int i=1; i<argc; ++i) {
+        if (std::strcmp(argv[i], "--physics-hz") == 0 && i+1 < argc) {
+            physics_hz = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--game") == 0 && i+1 < argc) {
+            const RuleSet* rules = find_rules(argv[++i]);
+            if (!rules) {
+                std::cerr << "Unknown game: " << argv[i] << ", expected 9ball, 8ball or 15red\n";
+                return EXIT_FAILURE;
+            }
+            game = rules->game;
+        } else if (std::strcmp(argv[i], "--contacts") == 0 && i+1 < argc) {
+            ++i;
+            if (std::strcmp(argv[i], "sequential") == 0) {
+                contacts = Contacts::Sequential;
+            } else if (std::strcmp(argv[i], "simultaneous") == 0) {
+                contacts = Contacts::Simultaneous;
+            } else {
+                std::cerr << "Unknown contact solver: " << argv[i] << ", expected sequential or simultaneous\n";
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(argv[i], "--low-latency") == 0) {
+            low_latency = true;
+        } else if (std::strcmp(argv[i], "--font") == 0 && i+1 < argc) {
+            font_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--record") == 0 && i+1 < argc) {
+            record_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--replay") == 0 && i+1 < argc) {
+            replay_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--trace") == 0 && i+1 < argc) {
+            trace_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--check-replay") == 0 && i+1 < argc) {
+            check_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--stream") == 0 && i+1 < argc) {
+            stream_targets.push_back(argv[++i]);
+        } else if (std::strcmp(argv[i], "--spectate") == 0 && i+1 < argc) {
+            spectate_port = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--export") == 0 && i+1 < argc) {
+            export_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--export-motion") == 0) {
+            export_motion = true;
+        } else if (std::strcmp(argv[i], "--analyze-break") == 0 && i+1 < argc) {
+            analyze_breaks_count = std::atoll(argv[++i]);
+        } else if (std::strcmp(argv[i], "--analyze-out") == 0 && i+1 < argc) {
+            analyze_path = argv[++i];
+        } else {
+            std::cerr << "Unknown argument: " << argv[i] << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (physics_hz <= 0) {
+        std::cerr << "Physics rate must be positive\n";
+        return EXIT_FAILURE;
+    }
+
+    if (!check_path.empty()) {
+        // headless: re-simulate and compare with the state the recording ended on
+        Replay replay;
+        if (!replay.load(check_path)) return EXIT_FAILURE;
+
+        Simulation sim;
+        ReplayPlayer player;
+        player.restart(sim, replay);
+        player.run_to_end(sim);
+
+        bool match = state_hash(sim) == replay.get_end_hash();
+        std::cout << check_path << ": " << replay.get_shots().size() << " shots, " << player.get_frame()
+                  << " steps, score " << sim.get_score() << (match ? ", matches\n" : ", DIVERGED\n");
+        return match ? 0 : EXIT_FAILURE;
+    }
+
+    if (analyze_breaks_count >= 0) {
+        // headless: CSV rows to stdout or --analyze-out, the summary after
+        BreakOptions options = default_break_options();
+        options.breaks = analyze_breaks_count;
+        options.physics_hz = physics_hz;
+        options.game = game;
+        options.contacts = contacts;
+
+        std::ofstream file;
+        if (!analyze_path.empty()) {
+            file.open(analyze_path);
+            if (!file) {
+                std::cerr << "Analysis Error: could not open " << analyze_path << "\n";
+                return EXIT_FAILURE;
+            }
+        }
+        std::ostream& csv = analyze_path.empty() ? std::cout : file;
+
+        ThreadPool pool;
+        BreakSummary summary = analyze_breaks(options, pool, csv);
+        Simulation sim;
+        sim.set_rules(rules_for(game));
+        print_break_summary(summary, sim, analyze_path.empty() ? std::cerr : std::cout);
+        return 0;
+    }
+
+    if (!export_path.empty()) {
+        // headless: draw the replay offscreen and write out the frames
+        if (replay_path.empty()) {
+            std::cerr << "--export needs a --replay to render\n";
+            return EXIT_FAILURE;
+        }
+        Table table(physics_hz, game, true);
+        if (!font_path.empty()) table.use_font(font_path);
+        if (!table.play(replay_path)) return EXIT_FAILURE;
+        return table.export_frames(export_path, export_motion) ? 0 : EXIT_FAILURE;
+    }
+
+    Table table(physics_hz, game);
+    table.set_contacts(contacts);
+    if (!font_path.empty()) table.use_font(font_path);
+    table.set_low_latency(low_latency);
+    if (!record_path.empty()) table.record_to(record_path);
+    if (!trace_path.empty()) table.trace_to(trace_path);
+    for (const std::string& target : stream_targets) {
+        if (!table.stream_to(target)) return EXIT_FAILURE;
+    }
+    if (spectate_port > 0 && !table.spectate(spectate_port)) return EXIT_FAILURE;
+    if (!replay_path.empty() && !table.play(replay_path)) return EXIT_FAILURE;
     table.run();
     return 0;
 }
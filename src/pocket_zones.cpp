@@ -0,0 +1,32 @@
+#include "pocket_zones.h"
+
+#include <algorithm>
+
+PocketZones::PocketZones() : left(-FLOAT_MAX), right(FLOAT_MAX), top(-FLOAT_MAX), bottom(FLOAT_MAX) {}
+
+void PocketZones::build(const std::vector<Position>& pockets) {
+    zones.clear();
+    left = -FLOAT_MAX;
+    right = FLOAT_MAX;
+    top = -FLOAT_MAX;
+    bottom = FLOAT_MAX;
+
+    for (const Position& pocket : pockets) {
+        Zone zone = {pocket.x - POCKET_RADIUS, pocket.x + POCKET_RADIUS,
+                     pocket.y - POCKET_RADIUS, pocket.y + POCKET_RADIUS, pocket};
+        zones.push_back(zone);
+
+        // grow the band of whichever rail the pocket is closest to, top and
+        // bottom winning ties so a corner pocket widens only one band
+        float to_left = pocket.x;
+        float to_right = TABLE_WIDTH - pocket.x;
+        float to_top = pocket.y;
+        float to_bottom = TABLE_HEIGHT - pocket.y;
+        float nearest = std::min(std::min(to_left, to_right), std::min(to_top, to_bottom));
+
+        if (nearest == to_top) top = std::max(top, zone.max_y);
+        else if (nearest == to_bottom) bottom = std::min(bottom, zone.min_y);
+        else if (nearest == to_left) left = std::max(left, zone.max_x);
+        else right = std::min(right, zone.min_x);
+    }
+}
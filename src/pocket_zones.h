@@ -0,0 +1,47 @@
+#ifndef POCKET_ZONES_H
+#define POCKET_ZONES_H
+
+#include "utility.h"
+
+#include <vector>
+
+// pocket broad phase. every pocket sits against a rail, so each one's capture
+// circle widens a band along its nearest rail, a corner pocket counting as on
+// the top or bottom rail. on the standard table that leaves just the top and
+// bottom bands, the left and right ones never grow. a ball between the bands,
+// which is most of the table, can't be in any pocket and costs four compares.
+// otherwise only pockets whose bounding box holds the ball get the squared
+// distance test
+class PocketZones {
+private:
+    struct Zone {
+        float min_x, max_x, min_y, max_y;
+        Position center;
+    };
+
+    std::vector<Zone> zones;
+    // the open middle of the table, no pocket reaches inside it. rails no
+    // pocket is nearest to stay at -/+FLOAT_MAX
+    float left, right, top, bottom;
+
+public:
+    PocketZones();
+
+    void build(const std::vector<Position>& pockets);
+
+    // index of the pocket the point is in, or -1
+    int find(float x, float y) const {
+        if (x > left && x < right && y > top && y < bottom) return -1;
+
+        for (int p=0; p<(int)zones.size(); ++p) {
+            const Zone& zone = zones[p];
+            if (x < zone.min_x || x > zone.max_x || y < zone.min_y || y > zone.max_y) continue;
+            float dx = x - zone.center.x;
+            float dy = y - zone.center.y;
+            if (dx*dx + dy*dy <= POCKET_RADIUS*POCKET_RADIUS) return p;
+        }
+        return -1;
+    }
+};
+
+#endif
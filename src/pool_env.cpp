@@ -0,0 +1,107 @@
+#include "pool_env.h"
+#include "simulation.h"
+#include "shot_cache.h"
+#include "thread_pool.h"
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+struct PoolEnv {
+    ThreadPool pool;
+    std::vector<Simulation> tables;
+    TableSnapshot rack;
+    int max_shots;
+    int obs_size;
+    std::unique_ptr<ShotCache> cache;
+
+    // per table: shots this episode, object balls down this episode
+    std::vector<int> shots;
+    std::vector<int> cleared;
+    std::vector<std::uint8_t> done;
+
+    PoolEnv(int batch, int threads) : pool(threads), tables(batch), shots(batch), cleared(batch), done(batch) {}
+};
+
+static void write_obs(const PoolEnv* env, int t, float* obs) {
+    const BallStore& balls = env->tables[t].get_balls();
+    float* out = obs + (size_t)t * env->obs_size;
+    for (int b=0; b<balls.count; ++b) {
+        out[3*b] = balls.x[b];
+        out[3*b + 1] = balls.y[b];
+        out[3*b + 2] = balls.active[b];
+    }
+}
+
+PoolEnv* pool_env_create(int batch, int threads, int physics_hz, int max_shots, const char* game) {
+    const RuleSet* rules = game ? find_rules(game) : &rules_for(Game::NineBall);
+    if (batch <= 0 || threads < 0 || physics_hz <= 0 || max_shots < 0 || !rules) return nullptr;
+
+    PoolEnv* env = new PoolEnv(batch, threads);
+    Simulation start;
+    start.set_rules(*rules);
+    start.set_step_rate(physics_hz);
+    start.save(env->rack);
+    for (Simulation& table : env->tables) table = start;
+    env->max_shots = max_shots;
+    env->obs_size = 3 * start.get_balls().count;
+    return env;
+}
+
+void pool_env_destroy(PoolEnv* env) { delete env; }
+
+int pool_env_batch(const PoolEnv* env) { return env->tables.size(); }
+int pool_env_obs_size(const PoolEnv* env) { return env->obs_size; }
+
+int pool_env_set_contacts(PoolEnv* env, const char* contacts) {
+    Contacts c;
+    if (std::strcmp(contacts, "sequential") == 0) c = Contacts::Sequential;
+    else if (std::strcmp(contacts, "simultaneous") == 0) c = Contacts::Simultaneous;
+    else return 0;
+
+    for (Simulation& table : env->tables) table.set_contacts(c);
+    return 1;
+}
+
+void pool_env_reset(PoolEnv* env, const uint8_t* mask, float* obs) {
+    for (size_t t=0; t<env->tables.size(); ++t) {
+        if (mask && !mask[t]) continue;
+        env->tables[t].restore(env->rack);
+        env->shots[t] = 0;
+        env->cleared[t] = 0;
+        env->done[t] = 0;
+    }
+    for (size_t t=0; t<env->tables.size(); ++t) write_obs(env, t, obs);
+}
+
+void pool_env_set_cache(PoolEnv* env, int entries) {
+    env->cache.reset(entries > 0 ? new ShotCache(entries) : nullptr);
+}
+
+void pool_env_cache_stats(const PoolEnv* env, long long* hits, long long* misses) {
+    *hits = env->cache ? env->cache->get_hits() : 0;
+    *misses = env->cache ? env->cache->get_misses() : 0;
+}
+
+void pool_env_step(PoolEnv* env, const float* angles, const float* powers,
+                   float* obs, float* rewards, uint8_t* dones) {
+    env->pool.run(env->tables.size(), [&](int, int t) {
+        Simulation& table = env->tables[t];
+        rewards[t] = 0;
+
+        if (!env->done[t]) {
+            ShotOutcome outcome = play_shot(table, angles[t], powers[t], env->cache.get());
+            env->cleared[t] += outcome.pocketed;
+            ++env->shots[t];
+            rewards[t] = outcome.score_delta;
+
+            // the table re-racks itself once cleared, which ends the episode
+            bool rack_cleared = env->cleared[t] >= table.get_balls().count - 1;
+            bool out_of_shots = env->max_shots > 0 && env->shots[t] >= env->max_shots;
+            env->done[t] = rack_cleared || out_of_shots;
+        }
+
+        dones[t] = env->done[t];
+        write_obs(env, t, obs);
+    });
+}
@@ -0,0 +1,54 @@
+#ifndef POOL_ENV_H
+#define POOL_ENV_H
+
+/* a batch of independent tables for training shot policies, as a plain C
+ * API so it can be loaded from Python (see python/pool_env.py). every step
+ * plays one shot on each table to rest, across a thread pool. all buffers
+ * belong to the caller and are written in place, laid out table by table:
+ *
+ *   obs      batch * pool_env_obs_size() floats, x, y, active per ball
+ *   rewards  batch floats, the shot's score change under the game's rule
+ *            set, ball values less any scratch penalty (see src/rules.h)
+ *   dones    batch bytes, 1 once the rack is cleared or max_shots is reached
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct PoolEnv PoolEnv;
+
+/* threads 0 means one per core, max_shots 0 means no shot limit. game is
+ * "9ball", "8ball" or "15red", null for 9-ball. null on bad settings */
+PoolEnv* pool_env_create(int batch, int threads, int physics_hz, int max_shots, const char* game);
+void pool_env_destroy(PoolEnv* env);
+
+int pool_env_batch(const PoolEnv* env);
+int pool_env_obs_size(const PoolEnv* env);
+
+/* "sequential" (the default) or "simultaneous", how the tables resolve
+ * balls touching at once, see src/contact_solver.h. 0 on an unknown name */
+int pool_env_set_contacts(PoolEnv* env, const char* contacts);
+
+/* re-racks the tables where mask is nonzero, or all of them when mask is
+ * null, and writes every table's observation */
+void pool_env_reset(PoolEnv* env, const uint8_t* mask, float* obs);
+
+/* remembers up to entries (table, shot) outcomes shared by every table,
+ * so shots repeated from the same position, like opening breaks, aren't
+ * simulated again. 0 turns it off, which is the default */
+void pool_env_set_cache(PoolEnv* env, int entries);
+void pool_env_cache_stats(const PoolEnv* env, long long* hits, long long* misses);
+
+/* shoots angles[i], powers[i] on table i and plays it out. tables already
+ * done are left alone and get a reward of 0 */
+void pool_env_step(PoolEnv* env, const float* angles, const float* powers,
+                   float* obs, float* rewards, uint8_t* dones);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,95 @@
+#include "prediction.h"
+
+#include <cmath>
+
+// keep a path point only where the direction turns by more than this (cos)
+constexpr float PATH_STRAIGHT = 0.9995f;
+
+// appends p, folding it into the last segment if the path goes straight on
+static void extend_path(std::vector<Position>& path, Position p) {
+    size_t n = path.size();
+    if (n >= 2) {
+        float ax = path[n-1].x - path[n-2].x;
+        float ay = path[n-1].y - path[n-2].y;
+        float bx = p.x - path[n-1].x;
+        float by = p.y - path[n-1].y;
+        float lengths = std::sqrt((ax*ax + ay*ay) * (bx*bx + by*by));
+        if (lengths > 0 && (ax*bx + ay*by) >= PATH_STRAIGHT * lengths) {
+            path[n-1] = p;
+            return;
+        }
+    }
+    if (n == 0 || path[n-1].x != p.x || path[n-1].y != p.y) path.push_back(p);
+}
+
+// nothing travels more than a diameter a step, so anything further was respotted
+static bool respotted(Position from, Position to) {
+    return std::fabs(to.x - from.x) > 2*BALL_RADIUS || std::fabs(to.y - from.y) > 2*BALL_RADIUS;
+}
+
+ShotPredictor::ShotPredictor()
+    : valid(false), key_angle(0), key_power(0), key_version(0), recomputes(0) {}
+
+int ShotPredictor::get_recomputes() const { return recomputes; }
+
+const ShotPrediction& ShotPredictor::predict(const Simulation& sim, float angle, float power) {
+    if (!valid || angle != key_angle || power != key_power || sim.get_state_version() != key_version) {
+        key_angle = angle;
+        key_power = power;
+        key_version = sim.get_state_version();
+        simulate(sim, angle, power);
+        valid = true;
+        ++recomputes;
+    }
+    return prediction;
+}
+
+void ShotPredictor::simulate(const Simulation& sim, float angle, float power) {
+    preview = sim;
+    preview.set_profiler(nullptr); // keep previews out of the frame timings
+    const BallStore& balls = preview.get_balls();
+
+    prediction.cue_path.clear();
+    prediction.hit_path.clear();
+    prediction.scratch = false;
+    prediction.first_hit = -1;
+
+    extend_path(prediction.cue_path, balls.get_position(CUE_BALL));
+    preview.shoot(angle, power);
+
+    bool cue_done = false;
+    bool hit_done = false;
+    for (int n=0; n<PREDICTION_MAX_STEPS && !preview.is_at_rest(); ++n) {
+        int score = preview.get_score();
+        preview.step();
+
+        if (!cue_done) {
+            Position cue = balls.get_position(CUE_BALL);
+
+            // a scratch or a re-rack respots the cueball, end the path there
+            if (respotted(prediction.cue_path.back(), cue)) {
+                prediction.scratch = preview.get_score() < score;
+                cue_done = true;
+            } else {
+                extend_path(prediction.cue_path, cue);
+            }
+        }
+
+        if (prediction.first_hit == -1) {
+            for (int i=1; i<balls.count; ++i) {
+                if (balls.active[i] && balls.is_moving(i)) {
+                    prediction.first_hit = i;
+                    extend_path(prediction.hit_path, sim.get_balls().get_position(i));
+                    break;
+                }
+            }
+        }
+
+        if (prediction.first_hit != -1 && !hit_done) {
+            // a pocketed ball is left where it dropped, so this ends at the pocket
+            Position hit = balls.get_position(prediction.first_hit);
+            hit_done = !balls.active[prediction.first_hit] || respotted(prediction.hit_path.back(), hit);
+            if (!respotted(prediction.hit_path.back(), hit)) extend_path(prediction.hit_path, hit);
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef PREDICTION_H
+#define PREDICTION_H
+
+#include "utility.h"
+#include "simulation.h"
+
+#include <vector>
+
+constexpr int PREDICTION_MAX_STEPS = 600;
+
+struct ShotPrediction {
+    std::vector<Position> cue_path;
+    bool scratch;
+    int first_hit; // object ball the cueball touches first, or -1
+    std::vector<Position> hit_path;
+};
+
+// previews a shot by running a copy of the simulation forward through every
+// contact and cushion. the result is cached on the exact angle and power and
+// the table's state version, so a still aim costs nothing and the path drawn
+// is always the shot a click would play
+class ShotPredictor {
+private:
+    Simulation preview;
+    ShotPrediction prediction;
+    bool valid;
+    float key_angle, key_power;
+    int key_version;
+    int recomputes;
+
+    void simulate(const Simulation& sim, float angle, float power);
+
+public:
+    ShotPredictor();
+
+    const ShotPrediction& predict(const Simulation& sim, float angle, float power);
+    int get_recomputes() const;
+};
+
+#endif
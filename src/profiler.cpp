@@ -0,0 +1,93 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+const char* phase_name(Phase phase) {
+    switch (phase) {
+        case Phase::Input: return "input";
+        case Phase::Update: return "update";
+        case Phase::Move: return "move";
+        case Phase::Collisions: return "collisions";
+        case Phase::Pockets: return "pockets";
+        case Phase::Render: return "render";
+        case Phase::Sleep: return "sleep";
+        case Phase::AimLatency: return "aim lag";
+        case Phase::InputLatency: return "input lag";
+        default: return "?";
+    }
+}
+
+Profiler::Profiler() : enabled(false), tracing(false), origin(std::chrono::steady_clock::now()) {
+    for (int i=0; i<(int)Phase::Count; ++i) next_sample[i] = 0;
+}
+
+void Profiler::set_enabled(bool on) { enabled = on; }
+
+void Profiler::start_trace() {
+    std::lock_guard<std::mutex> lock(mutex);
+    trace.clear();
+    // reserved up front so recording never reallocates mid-frame
+    trace.reserve(MAX_TRACE_EVENTS);
+    tracing = true;
+}
+
+// small stable id per thread for the trace, in order of first use
+static int trace_thread() {
+    static std::atomic<int> next_id(1);
+    thread_local int id = next_id++;
+    return id;
+}
+
+void Profiler::record(Phase phase, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    int p = (int)phase;
+    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    int thread = trace_thread();
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<double>& window = samples[p];
+    if ((int)window.size() < PROFILE_WINDOW) {
+        window.push_back(ms);
+    } else {
+        window[next_sample[p]] = ms;
+    }
+    next_sample[p] = (next_sample[p] + 1) % PROFILE_WINDOW;
+
+    if (tracing && trace.size() < MAX_TRACE_EVENTS) {
+        std::int64_t start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start - origin).count();
+        std::int64_t duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        trace.push_back({phase, thread, start_ns, duration_ns});
+    }
+}
+
+PhaseStats Profiler::stats(Phase phase) const {
+    std::unique_lock<std::mutex> lock(mutex);
+    std::vector<double> sorted = samples[(int)phase];
+    lock.unlock();
+    if (sorted.empty()) return {0, 0, 0, 0};
+
+    std::sort(sorted.begin(), sorted.end());
+    size_t n = sorted.size();
+    return {sorted[n/2], sorted[std::min(n - 1, n*99/100)], sorted[n-1], (int)n};
+}
+
+bool Profiler::write_trace(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "Trace Error: could not write " << path << "\n";
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    // timestamps in microseconds
+    file << "{\"traceEvents\":[\n";
+    for (size_t i=0; i<trace.size(); ++i) {
+        const TraceEvent& e = trace[i];
+        file << "{\"name\":\"" << phase_name(e.phase) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread << ",\"ts\":"
+             << e.start_ns / 1000.0 << ",\"dur\":" << e.duration_ns / 1000.0 << "}"
+             << (i+1 < trace.size() ? ",\n" : "\n");
+    }
+    file << "],\"displayTimeUnit\":\"ms\"}\n";
+    return (bool)file;
+}
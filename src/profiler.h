@@ -0,0 +1,93 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class Phase {
+    Input,
+    Update,
+    Move, // step() pieces, nested inside Update
+    Collisions,
+    Pockets,
+    Render,
+    Sleep,
+    // not timed sections but latencies, recorded after each present: from
+    // the mouse sample the cue was drawn with, and from the oldest mouse
+    // motion event the frame shows
+    AimLatency,
+    InputLatency,
+    Count,
+};
+
+const char* phase_name(Phase phase);
+
+// samples kept per phase for the rolling percentiles
+constexpr int PROFILE_WINDOW = 256;
+// cap on recorded trace events, ~40 bytes each
+constexpr size_t MAX_TRACE_EVENTS = 1 << 20;
+
+struct PhaseStats {
+    double p50, p99, max; // milliseconds over the window
+    int samples;
+};
+
+// per-phase wall time. when neither the overlay nor a trace wants it, a
+// ScopedTimer costs a null check and an atomic load, so it stays compiled in.
+// physics and rendering record from their own threads, so samples go in
+// under a lock, only taken while profiling
+class Profiler {
+private:
+    struct TraceEvent {
+        Phase phase;
+        int thread;
+        std::int64_t start_ns, duration_ns;
+    };
+
+    std::atomic<bool> enabled;
+    std::atomic<bool> tracing;
+    std::chrono::steady_clock::time_point origin;
+    mutable std::mutex mutex;
+
+    std::vector<double> samples[(int)Phase::Count];
+    int next_sample[(int)Phase::Count];
+    std::vector<TraceEvent> trace;
+
+public:
+    Profiler();
+
+    void set_enabled(bool on);
+    bool is_enabled() const {
+        return enabled.load(std::memory_order_relaxed) || tracing.load(std::memory_order_relaxed);
+    }
+    void start_trace();
+
+    void record(Phase phase, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+    PhaseStats stats(Phase phase) const;
+    // Chrome trace event format, open in chrome://tracing or Perfetto
+    bool write_trace(const std::string& path) const;
+};
+
+class ScopedTimer {
+private:
+    Profiler* profiler;
+    Phase phase;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    ScopedTimer(Profiler* p, Phase phase) : profiler(p && p->is_enabled() ? p : nullptr), phase(phase) {
+        if (profiler) start = std::chrono::steady_clock::now();
+    }
+    ~ScopedTimer() {
+        if (profiler) profiler->record(phase, start, std::chrono::steady_clock::now());
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include "render.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+void render_draw_filled_circle(SDL_Renderer* renderer, int center_x, int center_y, int radius) {
+    int x = 0;
+    int y = radius;
+    int decision = 1 - radius;
+
+    while (x <= y) {
+        SDL_RenderDrawLine(renderer, center_x - x, center_y + y, center_x + x, center_y + y);
+        SDL_RenderDrawLine(renderer, center_x - x, center_y - y, center_x + x, center_y - y);
+        SDL_RenderDrawLine(renderer, center_x - y, center_y + x, center_x + y, center_y + x);
+        SDL_RenderDrawLine(renderer, center_x - y, center_y - x, center_x + y, center_y - x);
+
+        ++x;
+        if (decision < 0) {
+            decision += 2*x + 1;
+        } else {
+            --y;
+            decision += 2*(x-y) + 1;
+        }
+    }
+}
+
+void render_draw_ball(SDL_Renderer* renderer, Position pos, Color color) {
+    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+    render_draw_filled_circle(renderer, pos.x, pos.y, BALL_RADIUS);
+}
+
+CircleBatch::CircleBatch() : renderer(nullptr), texture(nullptr) {}
+
+CircleBatch::~CircleBatch() {
+    unload();
+}
+
+bool CircleBatch::load(SDL_Renderer* r) {
+    renderer = r;
+
+    std::vector<Uint32> pixels(CIRCLE_SPRITE_SIZE*CIRCLE_SPRITE_SIZE);
+    const float radius = CIRCLE_SPRITE_SIZE / 2.0f;
+
+    // coverage falls off over the one pixel straddling the edge
+    for (int y=0; y<CIRCLE_SPRITE_SIZE; ++y) {
+        for (int x=0; x<CIRCLE_SPRITE_SIZE; ++x) {
+            float dx = x + 0.5f - radius;
+            float dy = y + 0.5f - radius;
+            float coverage = std::clamp(radius - std::sqrt(dx*dx + dy*dy) + 0.5f, 0.0f, 1.0f);
+
+            Uint8 rgba[4] = {255, 255, 255, (Uint8)(coverage * 255)};
+            std::memcpy(&pixels[y*CIRCLE_SPRITE_SIZE + x], rgba, 4);
+        }
+    }
+
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1");
+    texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC,
+                                CIRCLE_SPRITE_SIZE, CIRCLE_SPRITE_SIZE);
+    if (!texture) return false;
+
+    SDL_UpdateTexture(texture, nullptr, pixels.data(), CIRCLE_SPRITE_SIZE * sizeof(Uint32));
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    return true;
+}
+
+void CircleBatch::unload() {
+    if (texture) SDL_DestroyTexture(texture);
+    texture = nullptr;
+}
+
+bool CircleBatch::is_loaded() const { return texture != nullptr; }
+
+void CircleBatch::add(Position center, float radius, Color color) {
+    SDL_Color tint = {color.r, color.g, color.b, color.a};
+    float left = center.x - radius;
+    float top = center.y - radius;
+    float right = center.x + radius;
+    float bottom = center.y + radius;
+
+    int base = vertices.size();
+    vertices.push_back({{left, top}, tint, {0, 0}});
+    vertices.push_back({{right, top}, tint, {1, 0}});
+    vertices.push_back({{right, bottom}, tint, {1, 1}});
+    vertices.push_back({{left, bottom}, tint, {0, 1}});
+    indices.insert(indices.end(), {base, base+1, base+2, base, base+2, base+3});
+}
+
+void CircleBatch::flush() {
+    if (indices.empty()) return;
+
+    SDL_RenderGeometry(renderer, texture, vertices.data(), vertices.size(), indices.data(), indices.size());
+    vertices.clear();
+    indices.clear();
+}
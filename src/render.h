@@ -0,0 +1,39 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "utility.h"
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+// texture size for the pre-rasterized disc, downscaled when drawn
+constexpr int CIRCLE_SPRITE_SIZE = 64;
+
+// used to draw balls and pockets
+void render_draw_filled_circle(SDL_Renderer* renderer, int center_x, int center_y, int radius);
+void render_draw_ball(SDL_Renderer* renderer, Position pos, Color color);
+
+// an anti-aliased white disc rasterized once, drawn as vertex-tinted quads so
+// every ball and pocket in a frame goes out in a single geometry call. if it
+// fails to load, callers fall back to render_draw_filled_circle
+class CircleBatch {
+private:
+    SDL_Renderer* renderer;
+    SDL_Texture* texture;
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+
+public:
+    CircleBatch();
+    ~CircleBatch();
+
+    bool load(SDL_Renderer* renderer);
+    // textures belong to the renderer, so this has to run before it's destroyed
+    void unload();
+    bool is_loaded() const;
+
+    void add(Position center, float radius, Color color);
+    void flush();
+};
+
+#endif
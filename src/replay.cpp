@@ -0,0 +1,281 @@
+#include "replay.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+static void put_u32(std::vector<std::uint8_t>& out, std::uint32_t v) {
+    for (int i=0; i<4; ++i) out.push_back((v >> (8*i)) & 0xff);
+}
+
+static void put_u64(std::vector<std::uint8_t>& out, std::uint64_t v) {
+    for (int i=0; i<8; ++i) out.push_back((v >> (8*i)) & 0xff);
+}
+
+static void put_varint(std::vector<std::uint8_t>& out, std::uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back((v & 0x7f) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(v);
+}
+
+static void put_float(std::vector<std::uint8_t>& out, float f) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    put_u32(out, bits);
+}
+
+// bounds-checked cursor over a loaded file, ok goes false on a short read
+struct Reader {
+    const std::vector<std::uint8_t>& data;
+    size_t at;
+    bool ok;
+
+    std::uint64_t bytes(int n) {
+        if (at + n > data.size()) {
+            ok = false;
+            return 0;
+        }
+        std::uint64_t v = 0;
+        for (int i=0; i<n; ++i) v |= (std::uint64_t)data[at++] << (8*i);
+        return v;
+    }
+
+    std::uint64_t varint() {
+        std::uint64_t v = 0;
+        for (int shift=0; shift<64; shift+=7) {
+            if (at >= data.size()) break;
+            std::uint8_t b = data[at++];
+            v |= (std::uint64_t)(b & 0x7f) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        ok = false;
+        return 0;
+    }
+
+    float real() {
+        std::uint32_t bits = bytes(4);
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+};
+
+std::uint64_t state_hash(const Simulation& sim) {
+    // FNV-1a
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    auto mix = [&hash](const void* p, size_t n) {
+        const std::uint8_t* bytes = (const std::uint8_t*)p;
+        for (size_t i=0; i<n; ++i) {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ull;
+        }
+    };
+
+    const BallStore& balls = sim.get_balls();
+    size_t n = balls.count;
+    mix(balls.x.data(), n * sizeof(float));
+    mix(balls.y.data(), n * sizeof(float));
+    mix(balls.dx.data(), n * sizeof(float));
+    mix(balls.dy.data(), n * sizeof(float));
+    mix(balls.active.data(), n);
+    int score = sim.get_score();
+    mix(&score, sizeof(score));
+    return hash;
+}
+
+Replay::Replay() : physics_hz(FPS), game(Game::NineBall), contacts(Contacts::Sequential), end_frame(0), end_score(0), end_hash(0) {}
+
+void Replay::start(const Simulation& sim, int hz) {
+    const BallStore& balls = sim.get_balls();
+    physics_hz = hz;
+    game = sim.get_rules().game;
+    contacts = sim.get_contacts();
+    rack.assign(balls.initial.begin() + 1, balls.initial.begin() + balls.count);
+    shots.clear();
+    end_frame = 0;
+    end_score = sim.get_score();
+    end_hash = state_hash(sim);
+}
+
+void Replay::record_shot(std::uint32_t frame, float angle, float power) {
+    shots.push_back({frame, angle, power});
+}
+
+void Replay::finish(const Simulation& sim, std::uint32_t frame) {
+    end_frame = frame;
+    end_score = sim.get_score();
+    end_hash = state_hash(sim);
+}
+
+void Replay::truncate(std::uint32_t frame) {
+    while (!shots.empty() && shots.back().frame >= frame) shots.pop_back();
+}
+
+int Replay::get_physics_hz() const { return physics_hz; }
+Game Replay::get_game() const { return game; }
+Contacts Replay::get_contacts() const { return contacts; }
+const std::vector<Position>& Replay::get_rack() const { return rack; }
+const std::vector<ReplayShot>& Replay::get_shots() const { return shots; }
+std::uint32_t Replay::get_end_frame() const { return end_frame; }
+int Replay::get_end_score() const { return end_score; }
+std::uint64_t Replay::get_end_hash() const { return end_hash; }
+
+bool Replay::save(const std::string& path) const {
+    std::vector<std::uint8_t> out;
+    put_u32(out, REPLAY_MAGIC);
+    out.push_back(REPLAY_VERSION);
+    put_varint(out, physics_hz);
+    out.push_back((std::uint8_t)game);
+    out.push_back((std::uint8_t)contacts);
+
+    put_varint(out, rack.size());
+    for (const Position& p : rack) {
+        put_float(out, p.x);
+        put_float(out, p.y);
+    }
+
+    put_varint(out, shots.size());
+    std::uint32_t last = 0;
+    for (const ReplayShot& shot : shots) {
+        put_varint(out, shot.frame - last);
+        put_float(out, shot.angle);
+        put_float(out, shot.power);
+        last = shot.frame;
+    }
+
+    put_varint(out, end_frame - last);
+    put_u32(out, (std::uint32_t)end_score);
+    put_u64(out, end_hash);
+
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char*)out.data(), out.size());
+    if (!file) {
+        std::cerr << "Replay Error: could not write " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool Replay::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Replay Error: could not open " << path << "\n";
+        return false;
+    }
+    std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    Reader in{data, 0, true};
+    std::uint64_t version = 0;
+    if (in.bytes(4) != REPLAY_MAGIC || (version = in.bytes(1)) < 1 || version > REPLAY_VERSION) {
+        std::cerr << "Replay Error: " << path << " is not a version 1 to " << (int)REPLAY_VERSION << " replay\n";
+        return false;
+    }
+    physics_hz = in.varint();
+    std::uint64_t variant = version >= 2 ? in.bytes(1) : (std::uint64_t)Game::NineBall;
+    if (variant > (std::uint64_t)Game::FifteenRed) in.ok = false;
+    game = (Game)variant;
+    std::uint64_t solver = version >= 3 ? in.bytes(1) : (std::uint64_t)Contacts::Sequential;
+    if (solver > (std::uint64_t)Contacts::Simultaneous) in.ok = false;
+    contacts = (Contacts)solver;
+
+    size_t balls = in.varint();
+    if (balls >= (size_t)MAX_BALLS*64) in.ok = false;
+    rack.clear();
+    for (size_t i=0; in.ok && i<balls; ++i) {
+        float x = in.real();
+        float y = in.real();
+        rack.push_back({x, y});
+    }
+
+    size_t count = in.varint();
+    shots.clear();
+    std::uint32_t frame = 0;
+    for (size_t i=0; in.ok && i<count; ++i) {
+        frame += in.varint();
+        float angle = in.real();
+        float power = in.real();
+        shots.push_back({frame, angle, power});
+    }
+
+    end_frame = frame + in.varint();
+    end_score = (int)(std::uint32_t)in.bytes(4);
+    end_hash = in.bytes(8);
+
+    if (!in.ok || physics_hz <= 0) {
+        std::cerr << "Replay Error: " << path << " is truncated or corrupt\n";
+        return false;
+    }
+    return true;
+}
+
+ReplayPlayer::ReplayPlayer() : replay(nullptr), frame(0), next_shot(0) {}
+
+void ReplayPlayer::restart(Simulation& sim, const Replay& r) {
+    replay = &r;
+    sim.set_step_rate(r.get_physics_hz());
+    sim.set_rules(rules_for(r.get_game()));
+    sim.set_contacts(r.get_contacts());
+    sim.load_layout(r.get_rack());
+    sim.reset_score();
+    frame = 0;
+    next_shot = 0;
+    checkpoints.clear();
+}
+
+void ReplayPlayer::step(Simulation& sim) {
+    if (is_finished()) return;
+    const std::vector<ReplayShot>& shots = replay->get_shots();
+
+    // nothing happens at rest, jump straight to the next shot or the end
+    if (sim.is_at_rest()) {
+        std::uint32_t target = next_shot < shots.size() ? shots[next_shot].frame : replay->get_end_frame();
+        if (target > frame) frame = target;
+        if (is_finished()) return;
+    }
+
+    while (next_shot < shots.size() && shots[next_shot].frame == frame) {
+        if (checkpoints.size() == next_shot) {
+            checkpoints.emplace_back();
+            if (!sim.save(checkpoints.back(), frame)) checkpoints.pop_back();
+        }
+        sim.shoot(shots[next_shot].angle, shots[next_shot].power);
+        ++next_shot;
+    }
+    sim.step();
+    ++frame;
+}
+
+void ReplayPlayer::seek(Simulation& sim, size_t shot) {
+    if (!replay) return;
+    const std::vector<ReplayShot>& shots = replay->get_shots();
+    if (shot > shots.size()) shot = shots.size();
+    if (shot < next_shot) {
+        if (shot < checkpoints.size() && sim.restore(checkpoints[shot])) {
+            frame = checkpoints[shot].frame;
+            next_shot = shot;
+            return;
+        }
+        restart(sim, *replay);
+    }
+
+    std::uint32_t target = shot < shots.size() ? shots[shot].frame : replay->get_end_frame();
+    while (frame < target && !(next_shot == shot && sim.is_at_rest())) {
+        step(sim);
+    }
+    // at rest before the shot, the rest of the gap is idle
+    if (frame < target) frame = target;
+}
+
+void ReplayPlayer::run_to_end(Simulation& sim) {
+    while (!is_finished()) step(sim);
+}
+
+bool ReplayPlayer::is_finished() const {
+    return !replay || (next_shot == replay->get_shots().size() && frame >= replay->get_end_frame());
+}
+
+std::uint32_t ReplayPlayer::get_frame() const { return frame; }
+size_t ReplayPlayer::get_next_shot() const { return next_shot; }
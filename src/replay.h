@@ -0,0 +1,88 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "utility.h"
+#include "simulation.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+constexpr std::uint32_t REPLAY_MAGIC = 0x50524239; // "9BRP" on disk
+// 2 added the game, 3 the contact solver. 1 is always 9-ball, 1 and 2 sequential contacts
+constexpr std::uint8_t REPLAY_VERSION = 3;
+
+struct ReplayShot {
+    std::uint32_t frame; // physics steps since the rack, shot lands before the step
+    float angle, power;
+};
+
+// a game as its starting rack plus every shot and the step it was taken on.
+// the physics is deterministic, so that's enough to re-simulate it exactly.
+// floats are kept as raw bits, frames as varint deltas, so a shot is ~10 bytes
+class Replay {
+private:
+    int physics_hz;
+    Game game;
+    Contacts contacts;
+    std::vector<Position> rack; // object balls, the cueball always starts on its spot
+    std::vector<ReplayShot> shots;
+
+    // where the recording stopped, playback checks it lands on the same state
+    std::uint32_t end_frame;
+    int end_score;
+    std::uint64_t end_hash;
+
+public:
+    Replay();
+
+    void start(const Simulation& sim, int physics_hz);
+    void record_shot(std::uint32_t frame, float angle, float power);
+    void finish(const Simulation& sim, std::uint32_t frame);
+    // drop every shot from frame on, for undo
+    void truncate(std::uint32_t frame);
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    int get_physics_hz() const;
+    Game get_game() const;
+    Contacts get_contacts() const;
+    const std::vector<Position>& get_rack() const;
+    const std::vector<ReplayShot>& get_shots() const;
+    std::uint32_t get_end_frame() const;
+    int get_end_score() const;
+    std::uint64_t get_end_hash() const;
+};
+
+// bitwise digest of every ball and the score
+std::uint64_t state_hash(const Simulation& sim);
+
+// re-simulates a replay on a Simulation. idle stretches between shots are
+// skipped outright since nothing can change while the table is at rest, and
+// the table is snapshotted as each shot is first reached so seeking back is
+// a restore rather than a re-simulation from the rack
+class ReplayPlayer {
+private:
+    const Replay* replay;
+    std::uint32_t frame;
+    size_t next_shot;
+    std::vector<TableSnapshot> checkpoints; // [n] is just before shot n
+
+public:
+    ReplayPlayer();
+
+    // re-rack from the replay and rewind to frame 0
+    void restart(Simulation& sim, const Replay& r);
+    // advance one physics step, taking any shot recorded on it
+    void step(Simulation& sim);
+    // fast-forward to just before shot n is taken, from the rack if it's behind us
+    void seek(Simulation& sim, size_t shot);
+    void run_to_end(Simulation& sim);
+
+    bool is_finished() const;
+    std::uint32_t get_frame() const;
+    size_t get_next_shot() const;
+};
+
+#endif
@@ -0,0 +1,19 @@
+#include "rules.h"
+
+#include <cstring>
+
+// in Game order
+static constexpr RuleSet RULES[] = {
+    make_rules<NineBall>(),
+    make_rules<EightBall>(),
+    make_rules<FifteenRed>(),
+};
+
+const RuleSet& rules_for(Game game) { return RULES[(int)game]; }
+
+const RuleSet* find_rules(const char* name) {
+    for (const RuleSet& rules : RULES) {
+        if (std::strcmp(rules.name, name) == 0) return &rules;
+    }
+    return nullptr;
+}
@@ -0,0 +1,133 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include "utility.h"
+#include "ball.h"
+
+#include <array>
+#include <cstdint>
+
+enum class Game : std::uint8_t {
+    NineBall,
+    EightBall,
+    FifteenRed, // snooker style drill, reds only
+};
+
+// a game variant as plain data: its rack, what each ball is worth and what
+// a scratch costs. each one is built at compile time from a traits struct
+// below, so choosing a variant at startup is just picking a table
+struct RuleSet {
+    Game game;
+    const char* name;
+    int balls; // cue ball included
+    std::array<Position, MAX_BALLS> spots; // cue spot first
+    std::array<Color, MAX_BALLS> colors;
+    std::array<int, MAX_BALLS> points;     // for pocketing ball i
+    int scratch_penalty;
+};
+
+constexpr Position CUE_SPOT = {100, 200};
+constexpr Position RACK_APEX = {400, 200};
+
+// slot along a row of the rack, rows counted back from the apex ball.
+// the spacing the original 9-ball diamond has always used
+constexpr Position rack_spot(int row, int slot) {
+    return {RACK_APEX.x + 20.0f*row, RACK_APEX.y + 20.0f*slot - 10.0f*row};
+}
+
+struct NineBall {
+    static constexpr Game GAME = Game::NineBall;
+    static constexpr const char* NAME = "9ball";
+    static constexpr int BALLS = 10;
+    static constexpr int SCRATCH_PENALTY = 5;
+
+    static constexpr std::array<Position, BALLS> spots() {
+        return {{CUE_SPOT, rack_spot(0, 0), rack_spot(1, 0), rack_spot(1, 1),
+                 rack_spot(2, 0), rack_spot(2, 1), rack_spot(2, 2),
+                 rack_spot(3, 2), rack_spot(3, 1), rack_spot(4, 2)}};
+    }
+    static constexpr std::array<Color, BALLS> colors() {
+        return {{{255, 255, 255, 255}, {255, 255, 0, 255}, {0, 0, 255, 255},
+                 {255, 0, 0, 255}, {255, 165, 0, 255}, {0, 128, 0, 255},
+                 {128, 0, 128, 255}, {255, 20, 147, 255}, {0, 128, 128, 255},
+                 {128, 0, 0, 255}}};
+    }
+    static constexpr int points(int) { return 1; }
+};
+
+// 15 balls in a triangle, the 8 in the middle of the third row
+struct EightBall {
+    static constexpr Game GAME = Game::EightBall;
+    static constexpr const char* NAME = "8ball";
+    static constexpr int BALLS = 16;
+    static constexpr int SCRATCH_PENALTY = 5;
+
+    static constexpr std::array<Position, BALLS> spots() {
+        return {{CUE_SPOT, rack_spot(0, 0), rack_spot(1, 0), rack_spot(1, 1),
+                 rack_spot(2, 0), rack_spot(2, 2), rack_spot(3, 0),
+                 rack_spot(3, 3), rack_spot(2, 1), rack_spot(3, 1),
+                 rack_spot(3, 2), rack_spot(4, 0), rack_spot(4, 1),
+                 rack_spot(4, 2), rack_spot(4, 3), rack_spot(4, 4)}};
+    }
+    static constexpr std::array<Color, BALLS> colors() {
+        // solids, the 8, then stripes drawn a shade lighter
+        return {{{255, 255, 255, 255}, {255, 255, 0, 255}, {0, 0, 255, 255},
+                 {255, 0, 0, 255}, {128, 0, 128, 255}, {255, 165, 0, 255},
+                 {0, 128, 0, 255}, {128, 0, 0, 255}, {0, 0, 0, 255},
+                 {255, 255, 128, 255}, {128, 128, 255, 255}, {255, 128, 128, 255},
+                 {192, 128, 192, 255}, {255, 210, 128, 255}, {128, 192, 128, 255},
+                 {192, 128, 128, 255}}};
+    }
+    static constexpr int points(int) { return 1; }
+};
+
+// the full 15 ball triangle in reds, a red is worth 1 like in snooker and
+// a foul the minimum 4
+struct FifteenRed {
+    static constexpr Game GAME = Game::FifteenRed;
+    static constexpr const char* NAME = "15red";
+    static constexpr int BALLS = 16;
+    static constexpr int SCRATCH_PENALTY = 4;
+
+    static constexpr std::array<Position, BALLS> spots() {
+        std::array<Position, BALLS> out = {};
+        out[0] = CUE_SPOT;
+        int i = 1;
+        for (int row=0; row<5; ++row) {
+            for (int slot=0; slot<=row; ++slot) out[i++] = rack_spot(row, slot);
+        }
+        return out;
+    }
+    static constexpr std::array<Color, BALLS> colors() {
+        std::array<Color, BALLS> out = {};
+        out[0] = {255, 255, 255, 255};
+        for (int i=1; i<BALLS; ++i) out[i] = {200, 0, 0, 255};
+        return out;
+    }
+    static constexpr int points(int) { return 1; }
+};
+
+template <typename Rules>
+constexpr RuleSet make_rules() {
+    static_assert(Rules::BALLS <= MAX_BALLS, "a rack has to fit in a TableSnapshot");
+
+    RuleSet rules = {};
+    rules.game = Rules::GAME;
+    rules.name = Rules::NAME;
+    rules.balls = Rules::BALLS;
+    rules.scratch_penalty = Rules::SCRATCH_PENALTY;
+    std::array<Position, Rules::BALLS> spots = Rules::spots();
+    std::array<Color, Rules::BALLS> colors = Rules::colors();
+    for (int i=0; i<Rules::BALLS; ++i) {
+        rules.spots[i] = spots[i];
+        rules.colors[i] = colors[i];
+    }
+    for (int i=0; i<MAX_BALLS; ++i) rules.points[i] = Rules::points(i);
+    return rules;
+}
+
+const RuleSet& rules_for(Game game);
+// by name, "9ball", "8ball" or "15red". null when there's no such game
+const RuleSet* find_rules(const char* name);
+
+#endif
@@ -0,0 +1,142 @@
+#include "shot_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+std::uint64_t shot_key(const Simulation& sim, float angle, float power) {
+    // FNV-1a over the quantized values
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    auto mix = [&hash](std::int64_t value) {
+        for (int i=0; i<8; ++i) {
+            hash ^= (std::uint8_t)(value >> (8*i));
+            hash *= 0x100000001b3ull;
+        }
+    };
+    auto quantize = [](float value, float step) { return (std::int64_t)std::llround(value / step); };
+
+    const BallStore& balls = sim.get_balls();
+    mix(balls.count);
+    for (int i=0; i<balls.count; ++i) {
+        mix(balls.active[i]);
+        mix(quantize(balls.x[i], CACHE_POSITION_STEP));
+        mix(quantize(balls.y[i], CACHE_POSITION_STEP));
+        mix(quantize(balls.dx[i], CACHE_VELOCITY_STEP));
+        mix(quantize(balls.dy[i], CACHE_VELOCITY_STEP));
+        mix(quantize(balls.initial[i].x, CACHE_POSITION_STEP));
+        mix(quantize(balls.initial[i].y, CACHE_POSITION_STEP));
+    }
+
+    float time_step = sim.get_time_step();
+    std::uint32_t time_bits;
+    static_assert(sizeof(time_bits) == sizeof(time_step), "float is 32 bits");
+    std::memcpy(&time_bits, &time_step, sizeof(time_bits));
+    mix(time_bits);
+    mix((int)sim.get_engine());
+    mix((int)sim.get_contacts());
+    mix((int)sim.get_rules().game); // same spots can score differently
+    mix(sim.get_substepping());
+
+    mix(quantize(angle, CACHE_ANGLE_STEP));
+    mix(quantize(power, CACHE_POWER_STEP));
+    return hash;
+}
+
+ShotCache::ShotCache(size_t capacity)
+    : shards(SHOT_CACHE_SHARDS),
+      shard_capacity(std::max<size_t>(capacity / SHOT_CACHE_SHARDS, 1)),
+      hits(0),
+      misses(0) {}
+
+ShotCache::Shard& ShotCache::shard_for(std::uint64_t key) {
+    // the low bits pick the bucket inside the shard's map, so use the top
+    return shards[(key >> 56) % SHOT_CACHE_SHARDS];
+}
+
+bool ShotCache::lookup(std::uint64_t key, ShotOutcome& outcome, int max_steps) {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.index.find(key);
+    if (it == shard.index.end() || it->second->outcome.steps > max_steps) {
+        ++misses;
+        return false;
+    }
+    shard.order.splice(shard.order.begin(), shard.order, it->second);
+    outcome = it->second->outcome;
+    ++hits;
+    return true;
+}
+
+void ShotCache::store(std::uint64_t key, const ShotOutcome& outcome) {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        it->second->outcome = outcome;
+        shard.order.splice(shard.order.begin(), shard.order, it->second);
+        return;
+    }
+
+    if (shard.order.size() >= shard_capacity) {
+        shard.index.erase(shard.order.back().key);
+        shard.order.pop_back();
+    }
+    shard.order.push_front({key, outcome});
+    shard.index[key] = shard.order.begin();
+}
+
+void ShotCache::clear() {
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.order.clear();
+        shard.index.clear();
+    }
+    hits = 0;
+    misses = 0;
+}
+
+size_t ShotCache::size() {
+    size_t total = 0;
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.order.size();
+    }
+    return total;
+}
+
+long long ShotCache::get_hits() const { return hits; }
+long long ShotCache::get_misses() const { return misses; }
+
+ShotOutcome play_shot(Simulation& sim, float angle, float power, ShotCache* cache, int max_steps) {
+    ShotOutcome outcome;
+    int score = sim.get_score();
+    std::uint64_t key = 0;
+    bool cacheable = cache && sim.get_balls().count <= MAX_BALLS;
+
+    if (cacheable) {
+        key = shot_key(sim, angle, power);
+        if (cache->lookup(key, outcome, max_steps)) {
+            outcome.end.score = score + outcome.score_delta;
+            sim.restore(outcome.end);
+            return outcome;
+        }
+    }
+
+    sim.shoot(angle, power);
+    outcome.steps = sim.run_until_rest(max_steps);
+    outcome.score_delta = sim.get_score() - score;
+    outcome.pocketed = 0;
+    outcome.scratches = 0;
+    outcome.pocketed_mask = 0;
+    for (const PocketEvent& event : sim.get_pocketed()) {
+        if (event.ball == CUE_BALL) ++outcome.scratches;
+        else ++outcome.pocketed;
+        if (event.ball < 32) outcome.pocketed_mask |= 1u << event.ball;
+    }
+    sim.save(outcome.end);
+
+    if (cacheable && sim.is_at_rest()) cache->store(key, outcome);
+    return outcome;
+}
@@ -0,0 +1,84 @@
+#ifndef SHOT_CACHE_H
+#define SHOT_CACHE_H
+
+#include "utility.h"
+#include "simulation.h"
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// key resolution. tables closer than this share a result, well under
+// anything that shows up on screen or changes where a ball ends up
+constexpr float CACHE_POSITION_STEP = 1.0f / 1024;
+constexpr float CACHE_VELOCITY_STEP = 1.0f / 1024;
+constexpr float CACHE_ANGLE_STEP = 1e-5f;
+constexpr float CACHE_POWER_STEP = 1e-4f;
+
+// lock shards, so workers searching at once rarely wait on each other
+constexpr int SHOT_CACHE_SHARDS = 16;
+
+// what a shot did, enough to put a table straight into its end state
+struct ShotOutcome {
+    TableSnapshot end;
+    int score_delta;
+    int pocketed;  // object balls
+    int scratches;
+    std::uint32_t pocketed_mask; // bit per ball id that went down
+    int steps;
+};
+
+// hash of everything that decides a shot's outcome: the balls quantized to
+// the steps above, the rack spots balls reset to, the variant, the step
+// settings and the shot itself. score and frame don't change the physics
+// so aren't included
+std::uint64_t shot_key(const Simulation& sim, float angle, float power);
+
+// bounded (table, shot) -> outcome map with least recently used eviction.
+// safe to share between threads
+class ShotCache {
+private:
+    struct Entry {
+        std::uint64_t key;
+        ShotOutcome outcome;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> order; // front is the most recently used
+        std::unordered_map<std::uint64_t, std::list<Entry>::iterator> index;
+    };
+
+    std::vector<Shard> shards;
+    size_t shard_capacity;
+    std::atomic<long long> hits;
+    std::atomic<long long> misses;
+
+    Shard& shard_for(std::uint64_t key);
+
+public:
+    explicit ShotCache(size_t capacity = 4096);
+
+    // an entry that took more than max_steps would have been cut off, so
+    // it counts as a miss and isn't handed out
+    bool lookup(std::uint64_t key, ShotOutcome& outcome, int max_steps = std::numeric_limits<int>::max());
+    void store(std::uint64_t key, const ShotOutcome& outcome);
+    void clear();
+
+    size_t size();
+    long long get_hits() const;
+    long long get_misses() const;
+};
+
+// shoots and plays it out, or with a cache hit jumps straight to the end.
+// either way the result is in the outcome, sim.get_pocketed() is only
+// filled in when the shot was actually simulated. shots cut off by
+// max_steps aren't cached
+ShotOutcome play_shot(Simulation& sim, float angle, float power, ShotCache* cache = nullptr,
+                      int max_steps = 100000);
+
+#endif
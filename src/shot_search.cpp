@@ -0,0 +1,141 @@
+#include "shot_search.h"
+
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+// value of a pocketed ball, a scratch and an open pot left for the next shot
+constexpr float POT_VALUE = 10.0f;
+constexpr float SCRATCH_VALUE = -30.0f;
+constexpr float LEAVE_VALUE = 1.0f;
+
+SearchOptions default_search_options() {
+    SearchOptions options;
+    options.angle_spread = 0.5f;
+    options.min_power = 5.0f;
+    options.max_power = FPS/3.0f;
+    options.max_candidates = 512;
+    options.time_budget_ms = 100;
+    options.seed = 1;
+    options.engine = Engine::Stepped;
+    return options;
+}
+
+// closest approach of p to the segment a-b
+static float segment_distance(Position a, Position b, Position p) {
+    float dx = b.x - a.x;
+    float dy = b.y - a.y;
+    float length_sq = dx*dx + dy*dy;
+    float t = length_sq > 0 ? ((p.x - a.x)*dx + (p.y - a.y)*dy) / length_sq : 0;
+    t = std::fmax(0.0f, std::fmin(1.0f, t));
+
+    float cx = a.x + t*dx - p.x;
+    float cy = a.y + t*dy - p.y;
+    return std::sqrt(cx*cx + cy*cy);
+}
+
+static bool path_clear(const BallStore& balls, Position from, Position to, int skip_a, int skip_b) {
+    for (int k=0; k<balls.count; ++k) {
+        if (k == skip_a || k == skip_b || !balls.active[k]) continue;
+        if (segment_distance(from, to, balls.get_position(k)) < 2*BALL_RADIUS) return false;
+    }
+    return true;
+}
+
+int count_open_pots(const Simulation& sim) {
+    const BallStore& balls = sim.get_balls();
+    Position cue = balls.get_position(CUE_BALL);
+    int open = 0;
+
+    for (int i=1; i<balls.count; ++i) {
+        if (!balls.active[i]) continue;
+
+        Position target = balls.get_position(i);
+        if (!path_clear(balls, cue, target, CUE_BALL, i)) continue;
+
+        for (const Position& pocket : sim.get_pockets()) {
+            if (path_clear(balls, target, pocket, CUE_BALL, i)) {
+                ++open;
+                break;
+            }
+        }
+    }
+    return open;
+}
+
+ShotSearch::ShotSearch(ThreadPool& pool) : pool(pool), evaluated(0), cache(nullptr) {}
+
+void ShotSearch::set_cache(ShotCache* c) { cache = c; }
+
+int ShotSearch::get_evaluated() const { return evaluated; }
+
+void ShotSearch::evaluate(Simulation& local, ShotCandidate& candidate) {
+    ShotOutcome outcome = play_shot(local, candidate.angle, candidate.power, cache);
+    candidate.pocketed = outcome.pocketed;
+    candidate.scratch = outcome.scratches > 0;
+    candidate.leave = count_open_pots(local);
+    candidate.value = candidate.pocketed*POT_VALUE + candidate.leave*LEAVE_VALUE;
+    if (candidate.scratch) candidate.value += SCRATCH_VALUE;
+}
+
+ShotCandidate ShotSearch::search(const Simulation& sim, float angle, float power, const SearchOptions& options) {
+    // candidates are drawn up front so a search is repeatable for a seed,
+    // the current aim goes first so it's always considered
+    std::mt19937 rng(options.seed);
+    std::uniform_real_distribution<float> spread(-options.angle_spread, options.angle_spread);
+    std::uniform_real_distribution<float> powers(options.min_power, options.max_power);
+
+    int count = std::max(options.max_candidates, 1);
+    candidates.resize(count);
+    candidates[0] = {angle, power, 0, 0, false, 0};
+    for (int i=1; i<count; ++i) {
+        candidates[i] = {angle + spread(rng), powers(rng), 0, 0, false, 0};
+    }
+
+    // the copies couldn't switch engine, hand back the aim unplayed
+    if (options.engine == Engine::Event && sim.get_contacts() == Contacts::Simultaneous) {
+        std::cerr << "Search Error: the event engine can't search a table with simultaneous contacts\n";
+        evaluated = 0;
+        return candidates[0];
+    }
+
+    // each worker copies the table once, then rewinds it from a snapshot
+    // between candidates. tables too big for a snapshot copy every time
+    copies.resize(pool.size());
+    std::vector<std::uint8_t> primed(pool.size(), 0);
+    TableSnapshot start;
+    bool snapshot = sim.save(start);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double, std::milli>(options.time_budget_ms);
+    std::vector<std::uint8_t> done(count, 0);
+    std::atomic<int> finished(0);
+
+    pool.run(count, [&](int worker, int task) {
+        // always finish the current aim, skip the rest once time's up
+        if (task != 0 && std::chrono::steady_clock::now() > deadline) return;
+
+        Simulation& local = copies[worker];
+        if (snapshot && primed[worker]) {
+            local.restore(start);
+        } else {
+            local = sim;
+            local.set_engine(options.engine);
+            local.set_profiler(nullptr); // not thread safe, and not frame time
+            primed[worker] = 1;
+        }
+        evaluate(local, candidates[task]);
+        done[task] = 1;
+        ++finished;
+    });
+    evaluated = finished;
+
+    // ties go to the lower index, so the result doesn't depend on scheduling
+    int best = 0;
+    for (int i=1; i<count; ++i) {
+        if (done[i] && candidates[i].value > candidates[best].value) best = i;
+    }
+    return candidates[best];
+}
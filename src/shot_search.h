@@ -0,0 +1,58 @@
+#ifndef SHOT_SEARCH_H
+#define SHOT_SEARCH_H
+
+#include "utility.h"
+#include "simulation.h"
+#include "shot_cache.h"
+#include "thread_pool.h"
+
+#include <vector>
+
+struct SearchOptions {
+    float angle_spread;    // radians either side of the current aim
+    float min_power, max_power;
+    int max_candidates;
+    double time_budget_ms; // candidates not started by then are skipped
+    unsigned seed;
+    Engine engine;
+};
+
+SearchOptions default_search_options();
+
+struct ShotCandidate {
+    float angle, power;
+    float value;
+    int pocketed;
+    bool scratch;
+    int leave; // object balls with a clear pot after the shot
+};
+
+// "suggest shot": samples angle x power around the current aim, plays each
+// candidate out on per-worker copies of the table and scores the outcome by
+// balls pocketed, scratches and how good the cueball leave is
+class ShotSearch {
+private:
+    ThreadPool& pool;
+    std::vector<Simulation> copies;
+    std::vector<ShotCandidate> candidates;
+    int evaluated;
+    ShotCache* cache;
+
+    void evaluate(Simulation& local, ShotCandidate& candidate);
+
+public:
+    explicit ShotSearch(ThreadPool& pool);
+
+    // optional, candidates already played from the same table are looked up
+    void set_cache(ShotCache* c);
+
+    ShotCandidate search(const Simulation& sim, float angle, float power, const SearchOptions& options);
+    // how many candidates the last search got through within its budget
+    int get_evaluated() const;
+};
+
+// object balls the cueball can roll straight into and that can roll straight
+// on into some pocket without touching another ball
+int count_open_pots(const Simulation& sim);
+
+#endif
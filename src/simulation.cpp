@@ -0,0 +1,451 @@
+#include "simulation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iostream>
+
+Simulation::Simulation()
+    : rules(&rules_for(Game::NineBall)),
+      score(0),
+      layout_version(0),
+      state_version(0),
+      time_step(1.0f),
+      damping(DECELERATION),
+      substepping(true),
+      substeps_taken(0),
+      broad_phase(BroadPhase::Grid),
+      kernel_path(resolve_kernel_path(KernelPath::Auto)),
+      verify_kernels(false),
+      kernel_mismatches(0),
+      engine(Engine::Stepped),
+      contacts(Contacts::Sequential),
+      profiler(nullptr) {
+    initialize_balls();
+    refresh_awake();
+    initialize_pockets();
+}
+
+void Simulation::set_rules(const RuleSet& r) {
+    rules = &r;
+    initialize_balls();
+    grid.clear();
+    refresh_awake();
+    pocketed.clear();
+    score = 0;
+}
+
+const RuleSet& Simulation::get_rules() const { return *rules; }
+
+void Simulation::initialize_balls() {
+    if (balls.capacity() < rules->balls) balls = BallStore(rules->balls);
+    balls.clear();
+    for (int i=0; i<rules->balls; ++i) {
+        balls.add(rules->spots[i], rules->colors[i]);
+    }
+}
+
+void Simulation::load_layout(const std::vector<Position>& layout) {
+    // object balls take the variant's colors in turn
+    int colors = std::max(rules->balls - 1, 1);
+
+    balls = BallStore(layout.size() + 1);
+    balls.add(rules->spots[CUE_BALL], rules->colors[CUE_BALL]);
+    for (size_t i=0; i<layout.size(); ++i) {
+        balls.add(layout[i], rules->colors[1 + i % colors]);
+    }
+    grid.clear();
+    refresh_awake();
+}
+
+// re-rack in place from the stored initial positions
+void Simulation::reset_balls() {
+    balls.reset();
+    refresh_awake();
+}
+
+void Simulation::initialize_pockets() {
+    const int offset = 20;
+
+    pockets = {
+        {offset, offset},
+        {TABLE_WIDTH - offset, offset},
+        {offset, TABLE_HEIGHT - offset},
+        {TABLE_WIDTH - offset, TABLE_HEIGHT - offset},
+        {(int)(TABLE_WIDTH/2), offset},
+        {(int)(TABLE_WIDTH/2), TABLE_HEIGHT - offset}
+    };
+    pocket_zones.build(pockets);
+    ++layout_version;
+}
+
+void Simulation::check_collisions() {
+    if (contacts == Contacts::Simultaneous) {
+        solve_contacts();
+        return;
+    }
+
+    if (broad_phase == BroadPhase::Grid) {
+        grid.update(balls);
+        grid.find_pairs(balls, awake, pairs);
+
+        // pairs in id order, merged with those of balls knocked from rest
+        // along the way. a woken ball only adds the pairs after the one that
+        // woke it, the earlier ones were passed over while it was resting,
+        // which keeps the sweep in step with the brute force loop below
+        auto after = std::greater<std::pair<int, int>>();
+        woken_pairs.clear();
+        std::pair<int, int> last(-1, -1);
+        size_t next = 0;
+        while (next < pairs.size() || !woken_pairs.empty()) {
+            std::pair<int, int> pair;
+            if (woken_pairs.empty() || (next < pairs.size() && pairs[next] < woken_pairs.front())) {
+                pair = pairs[next++];
+            } else {
+                std::pop_heap(woken_pairs.begin(), woken_pairs.end(), after);
+                pair = woken_pairs.back();
+                woken_pairs.pop_back();
+            }
+            if (pair == last) continue;
+            last = pair;
+
+            bool first_moving = balls.is_moving(pair.first);
+            bool second_moving = balls.is_moving(pair.second);
+            if (!first_moving && !second_moving) continue;
+            if (!balls.check_collision(pair.first, pair.second)) continue;
+            balls.resolve_collision(pair.first, pair.second);
+
+            for (int woken : {first_moving ? -1 : pair.first, second_moving ? -1 : pair.second}) {
+                if (woken == -1 || !balls.is_moving(woken)) continue;
+                neighbours.clear();
+                grid.neighbour_pairs(woken, neighbours);
+                for (const std::pair<int, int>& later_pair : neighbours) {
+                    if (later_pair <= last) continue;
+                    woken_pairs.push_back(later_pair);
+                    std::push_heap(woken_pairs.begin(), woken_pairs.end(), after);
+                }
+            }
+        }
+        return;
+    }
+
+    // pairs in id order, so the cueball is checked against everything first.
+    // resolving moves ball i, so the sweep restarts after every contact
+    for (int i=0; i<balls.count; ++i) {
+        if (!balls.active[i]) continue;
+        for (int j=i+1; j<balls.count; ++j) {
+            if (!balls.is_moving(i)) {
+                // resting, so only a moving ball can hit it
+                if (balls.active[j] && balls.is_moving(j) && balls.check_collision(i, j)) {
+                    balls.resolve_collision(i, j);
+                }
+                continue;
+            }
+
+            int hit = find_contact(balls, i, j, balls.count, kernel_path);
+            if (verify_kernels && hit != find_contact(balls, i, j, balls.count, KernelPath::Scalar)) {
+                ++kernel_mismatches;
+            }
+            if (hit == balls.count) break;
+
+            balls.resolve_collision(i, hit); // handles the movement of both balls
+            j = hit;
+        }
+    }
+}
+
+void Simulation::solve_contacts() {
+    if (broad_phase == BroadPhase::Grid) {
+        grid.update(balls);
+        grid.find_pairs(balls, awake, pairs, true);
+    } else {
+        const float reach = 2*BALL_RADIUS + CONTACT_MARGIN;
+        pairs.clear();
+        for (int i=0; i<balls.count; ++i) {
+            if (!balls.active[i]) continue;
+            for (int j=i+1; j<balls.count; ++j) {
+                float dist_x = balls.x[i] - balls.x[j];
+                float dist_y = balls.y[i] - balls.y[j];
+                if (balls.active[j] && dist_x*dist_x + dist_y*dist_y <= reach*reach) pairs.push_back({i, j});
+            }
+        }
+    }
+    contact_solver.solve(balls, awake, pairs);
+}
+
+void Simulation::check_pockets() {
+    // only a ball that moved this step can have dropped
+    for (int i=1; i<balls.count; ++i) {
+        if (!was_awake[i] && !balls.is_moving(i)) continue;
+        if (!balls.active[i]) continue;
+        int pocket = pocket_zones.find(balls.x[i], balls.y[i]);
+        if (pocket != -1) step_pockets.push_back({i, pocket});
+    }
+    score_pockets();
+}
+
+void Simulation::score_pockets() {
+    for (const PocketEvent& event : step_pockets) pocket_ball(event.ball, event.pocket);
+    step_pockets.clear();
+}
+
+void Simulation::pocket_ball(int i, int pocket) {
+    pocketed.push_back({i, pocket});
+    if (i == CUE_BALL) {
+        // scratch, penalize
+        score -= rules->scratch_penalty;
+        balls.reset_ball(CUE_BALL);
+    } else {
+        balls.deactivate(i);
+        score += i < MAX_BALLS ? rules->points[i] : 1;
+    }
+}
+
+bool Simulation::is_ball_in_pocket(const Position& ball_pos) const {
+    return find_pocket(ball_pos) != -1;
+}
+
+int Simulation::find_pocket(const Position& ball_pos) const {
+    return pocket_zones.find(ball_pos.x, ball_pos.y);
+}
+
+void Simulation::set_step_rate(int hz) {
+    time_step = (float)FPS / hz;
+    damping = std::pow(DECELERATION, time_step);
+}
+
+float Simulation::get_time_step() const { return time_step; }
+void Simulation::set_substepping(bool on) { substepping = on; }
+bool Simulation::get_substepping() const { return substepping; }
+int Simulation::get_substeps_taken() const { return substeps_taken; }
+
+int substeps_for_speed(float max_speed, float time_step) {
+    float travel = max_speed * time_step;
+    if (travel <= MAX_STEP_TRAVEL) return 1;
+    return std::min((int)std::ceil(travel / MAX_STEP_TRAVEL), MAX_SUBSTEPS);
+}
+
+void substep_params(float time_step, int n, float& dt, float& damping) {
+    dt = time_step / n;
+    damping = std::pow(DECELERATION, dt);
+}
+
+int Simulation::substeps_needed() const {
+    if (!substepping) return 1;
+
+    float max_speed = 0;
+    for (int i : awake) {
+        max_speed = std::max(max_speed, std::max(std::fabs(balls.dx[i]), std::fabs(balls.dy[i])));
+    }
+    return substeps_for_speed(max_speed, time_step);
+}
+
+bool Simulation::set_engine(Engine e) {
+    if (e == Engine::Event && contacts == Contacts::Simultaneous) {
+        std::cerr << "Simulation Error: the event engine can't solve contacts simultaneously\n";
+        return false;
+    }
+    engine = e;
+    return true;
+}
+Engine Simulation::get_engine() const { return engine; }
+
+bool Simulation::set_contacts(Contacts c) {
+    if (c == Contacts::Simultaneous && engine == Engine::Event) {
+        std::cerr << "Simulation Error: the event engine can't solve contacts simultaneously\n";
+        return false;
+    }
+    contacts = c;
+    return true;
+}
+Contacts Simulation::get_contacts() const { return contacts; }
+void Simulation::set_contact_options(const ContactOptions& options) { contact_solver.set_options(options); }
+const ContactSolver& Simulation::get_contact_solver() const { return contact_solver; }
+
+void Simulation::set_broad_phase(BroadPhase phase) { broad_phase = phase; }
+BroadPhase Simulation::get_broad_phase() const { return broad_phase; }
+void Simulation::set_kernel_path(KernelPath path) { kernel_path = resolve_kernel_path(path); }
+KernelPath Simulation::get_kernel_path() const { return kernel_path; }
+void Simulation::set_profiler(Profiler* p) { profiler = p; }
+void Simulation::set_verify_kernels(bool verify) { verify_kernels = verify; }
+int Simulation::get_kernel_mismatches() const { return kernel_mismatches; }
+
+void Simulation::integrate(float dt, float step_damping) {
+    // verify mode checks whichever path is about to run against the scalar
+    // full width pass
+    if (verify_kernels) {
+        verify_store = balls;
+        integrate_balls(verify_store, KernelPath::Scalar, dt, step_damping);
+    }
+
+    // with only a few balls rolling, skip the full width kernel pass. the
+    // kernels leave resting balls alone, so both give the same bits
+    if ((int)awake.size()*4 < balls.count) {
+        for (int i : awake) balls.move(i, dt, step_damping);
+    } else {
+        integrate_balls(balls, kernel_path, dt, step_damping);
+    }
+    if (!verify_kernels) return;
+
+    size_t bytes = balls.count * sizeof(float);
+    if (std::memcmp(balls.x.data(), verify_store.x.data(), bytes) != 0 ||
+        std::memcmp(balls.y.data(), verify_store.y.data(), bytes) != 0 ||
+        std::memcmp(balls.dx.data(), verify_store.dx.data(), bytes) != 0 ||
+        std::memcmp(balls.dy.data(), verify_store.dy.data(), bytes) != 0) {
+        ++kernel_mismatches;
+    }
+}
+
+// every change to the balls ends here, so it also bumps the state version
+void Simulation::refresh_awake() {
+    ++state_version;
+    awake.clear();
+    was_awake.assign(balls.count, 0);
+    for (int i=0; i<balls.count; ++i) {
+        if (balls.active[i] && balls.is_moving(i)) {
+            awake.push_back(i);
+            was_awake[i] = 1;
+        }
+    }
+}
+
+bool Simulation::save(TableSnapshot& snapshot, std::uint32_t frame) const {
+    if (balls.count > MAX_BALLS) return false;
+
+    size_t bytes = balls.count * sizeof(float);
+    snapshot.count = balls.count;
+    snapshot.num_active = balls.num_active;
+    snapshot.score = score;
+    snapshot.frame = frame;
+    std::memcpy(snapshot.x, balls.x.data(), bytes);
+    std::memcpy(snapshot.y, balls.y.data(), bytes);
+    std::memcpy(snapshot.dx, balls.dx.data(), bytes);
+    std::memcpy(snapshot.dy, balls.dy.data(), bytes);
+    std::memcpy(snapshot.active, balls.active.data(), balls.count);
+    return true;
+}
+
+bool Simulation::restore(const TableSnapshot& snapshot) {
+    if (snapshot.count != balls.count) return false;
+
+    size_t bytes = balls.count * sizeof(float);
+    balls.num_active = snapshot.num_active;
+    score = snapshot.score;
+    std::memcpy(balls.x.data(), snapshot.x, bytes);
+    std::memcpy(balls.y.data(), snapshot.y, bytes);
+    std::memcpy(balls.dx.data(), snapshot.dx, bytes);
+    std::memcpy(balls.dy.data(), snapshot.dy, bytes);
+    std::memcpy(balls.active.data(), snapshot.active, balls.count);
+    pocketed.clear();
+    step_pockets.clear();
+    // the grid relinks whatever moved on its next update
+    refresh_awake();
+    return true;
+}
+
+bool Simulation::is_at_rest() const { return awake.empty(); }
+
+bool Simulation::can_shoot() const { return !balls.is_moving(CUE_BALL); }
+
+void Simulation::shoot(float angle, float power) {
+    pocketed.clear();
+    balls.apply_force(CUE_BALL, angle, power);
+    refresh_awake();
+}
+
+void Simulation::step() {
+    if (awake.empty()) return;
+
+    int n = substeps_needed();
+    if (n == 1) {
+        substep(time_step, damping);
+    } else {
+        float dt, step_damping;
+        substep_params(time_step, n, dt, step_damping);
+        for (int k=0; k<n; ++k) {
+            if (k > 0) {
+                refresh_awake();
+                if (awake.empty()) break;
+            }
+            substep(dt, step_damping);
+        }
+    }
+
+    refresh_awake();
+}
+
+void Simulation::substep(float dt, float step_damping) {
+    ++substeps_taken;
+    {
+        ScopedTimer timer(profiler, Phase::Move);
+        integrate(dt, step_damping);
+    }
+
+    int pocket = pocket_zones.find(balls.x[CUE_BALL], balls.y[CUE_BALL]);
+    if (pocket != -1) step_pockets.push_back({CUE_BALL, pocket});
+    score_pockets();
+
+    {
+        ScopedTimer timer(profiler, Phase::Collisions);
+        check_collisions();
+    }
+    {
+        ScopedTimer timer(profiler, Phase::Pockets);
+        check_pockets();
+    }
+
+    // reset non-cue balls only when all are pocketed
+    if (balls.num_active == 1) {
+        reset_balls();
+    }
+}
+
+int Simulation::run_until_rest(int max_steps) {
+    if (engine == Engine::Event) return run_events_until_rest(max_steps);
+
+    int steps = 0;
+    while (steps < max_steps && !is_at_rest()) {
+        step();
+        ++steps;
+    }
+    return steps;
+}
+
+int Simulation::run_events_until_rest(int max_steps) {
+    double max_time = max_steps * time_step;
+    double elapsed = 0;
+
+    while (elapsed < max_time) {
+        EventEngine::Advance result = event_engine.advance(balls, pockets, max_time - elapsed);
+        elapsed += result.time;
+        if (result.cut_off) {
+            // a cluster the events can't get through, step the rest of the shot
+            refresh_awake();
+            int steps = std::ceil(elapsed / time_step);
+            while (steps < max_steps && !is_at_rest()) {
+                step();
+                ++steps;
+            }
+            return steps;
+        }
+        if (result.pocketed == -1) break;
+
+        pocket_ball(result.pocketed, result.pocket);
+        if (balls.num_active == 1) {
+            reset_balls();
+        }
+    }
+
+    refresh_awake();
+    return std::ceil(elapsed / time_step);
+}
+
+const BallStore& Simulation::get_balls() const { return balls; }
+const std::vector<Position>& Simulation::get_pockets() const { return pockets; }
+const PocketZones& Simulation::get_pocket_zones() const { return pocket_zones; }
+const std::vector<PocketEvent>& Simulation::get_pocketed() const { return pocketed; }
+int Simulation::get_score() const { return score; }
+void Simulation::reset_score() { score = 0; }
+int Simulation::get_layout_version() const { return layout_version; }
+int Simulation::get_state_version() const { return state_version; }
@@ -0,0 +1,194 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "utility.h"
+#include "ball.h"
+#include "grid.h"
+#include "kernels.h"
+#include "event_engine.h"
+#include "contact_solver.h"
+#include "pocket_zones.h"
+#include "profiler.h"
+#include "rules.h"
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// furthest a ball may travel in one sub-step. at full power (20 px a frame)
+// that's 4 sub-steps, a slow table never splits at all
+constexpr float MAX_STEP_TRAVEL = BALL_RADIUS / 2.0f;
+constexpr int MAX_SUBSTEPS = 8;
+
+// sub-steps needed when the fastest ball moves max_speed px per 60 Hz frame
+int substeps_for_speed(float max_speed, float time_step);
+// length and damping of one of n sub-steps
+void substep_params(float time_step, int n, float& dt, float& damping);
+
+enum class BroadPhase {
+    Grid,
+    BruteForce, // all pairs, make check validates the grid against it
+};
+
+enum class Engine {
+    Stepped,
+    Event, // time-of-impact solver, only used by run_until_rest
+};
+
+// everything that changes during play on a standard table, in fixed arrays so
+// copying one is a straight memcpy with no allocation. the rack itself (spots,
+// colors) isn't in here, a snapshot only restores onto the table it came from
+struct TableSnapshot {
+    std::int32_t count, num_active;
+    std::int32_t score;
+    std::uint32_t frame; // caller's step counter, for replay and undo
+    float x[MAX_BALLS], y[MAX_BALLS];
+    float dx[MAX_BALLS], dy[MAX_BALLS];
+    std::uint8_t active[MAX_BALLS];
+};
+static_assert(std::is_trivially_copyable<TableSnapshot>::value, "snapshots are copied as raw bytes");
+
+// a ball dropping, pocket is an index into get_pockets()
+struct PocketEvent {
+    int ball;
+    int pocket;
+};
+
+// headless physics and scoring, no SDL. Table is a front-end over this
+class Simulation {
+private:
+    BallStore balls;
+    std::vector<Position> pockets;
+    PocketZones pocket_zones;
+    const RuleSet* rules; // rack and scoring, 9-ball unless set
+    int score;
+    // bumped whenever the static geometry changes, so cached renders know
+    int layout_version;
+    // bumped whenever any ball moves or the rack changes
+    int state_version;
+
+    // step length in 60 Hz frames, so velocities and shot power keep their
+    // per-frame units whatever rate the physics runs at
+    float time_step;
+    float damping;
+    // split a step when the fastest ball would move too far in one
+    bool substepping;
+    int substeps_taken;
+
+    BroadPhase broad_phase;
+    BroadPhaseGrid grid;
+    std::vector<std::pair<int, int>> pairs;
+    // min-heap of pairs brought in by balls knocked from rest mid sweep
+    std::vector<std::pair<int, int>> woken_pairs, neighbours;
+
+    KernelPath kernel_path;
+    // test mode: rerun every kernel on the scalar path and compare bits
+    bool verify_kernels;
+    BallStore verify_store;
+    int kernel_mismatches;
+
+    Engine engine;
+    EventEngine event_engine;
+
+    // how the stepped engine resolves a step's collisions
+    Contacts contacts;
+    ContactSolver contact_solver;
+
+    void solve_contacts();
+
+    // balls moving at the start of the step. nothing else gets integrated,
+    // and a pair is only tested when one side is moving, since two resting
+    // balls can't resolve anything
+    std::vector<int> awake;
+    std::vector<std::uint8_t> was_awake;
+
+    void refresh_awake();
+
+    // every ball dropped since the last shot, in the order they went down.
+    // detection only queues into step_pockets, scoring then works through it
+    std::vector<PocketEvent> pocketed;
+    std::vector<PocketEvent> step_pockets;
+
+    // optional, times the pieces of step() when set
+    Profiler* profiler;
+
+    int substeps_needed() const;
+    void integrate(float dt, float step_damping);
+    void substep(float dt, float step_damping);
+    void pocket_ball(int i, int pocket);
+    void score_pockets();
+    int run_events_until_rest(int max_steps);
+
+public:
+    Simulation();
+
+    // switches variant, re-racks and clears the score
+    void set_rules(const RuleSet& r);
+    const RuleSet& get_rules() const;
+
+    void initialize_balls();
+    // replace the rack with custom object ball positions (drills, stress
+    // layouts), the cue ball keeps its usual spot
+    void load_layout(const std::vector<Position>& layout);
+    void reset_balls();
+    void initialize_pockets();
+    void check_collisions();
+    void check_pockets();
+    bool is_ball_in_pocket(const Position& ball_pos) const;
+    // index of the pocket the ball is in, or -1
+    int find_pocket(const Position& ball_pos) const;
+
+    void set_step_rate(int hz);
+    float get_time_step() const;
+    void set_substepping(bool on);
+    bool get_substepping() const;
+    // total sub-steps run, equal to steps taken when nothing was fast
+    int get_substeps_taken() const;
+
+    // the event engine resolves each hit at its own time, so it has no
+    // Contacts::Simultaneous. both setters refuse that pairing and return
+    // false, leaving the setting as it was
+    bool set_engine(Engine e);
+    Engine get_engine() const;
+    bool set_contacts(Contacts c);
+    Contacts get_contacts() const;
+    void set_contact_options(const ContactOptions& options);
+    // iteration counts and convergence for Contacts::Simultaneous
+    const ContactSolver& get_contact_solver() const;
+
+    void set_broad_phase(BroadPhase phase);
+    BroadPhase get_broad_phase() const;
+    void set_kernel_path(KernelPath path);
+    KernelPath get_kernel_path() const;
+    void set_profiler(Profiler* p);
+    void set_verify_kernels(bool verify);
+    int get_kernel_mismatches() const;
+
+    // false when the table has more balls than a snapshot holds, or the
+    // snapshot is from a different rack
+    bool save(TableSnapshot& snapshot, std::uint32_t frame = 0) const;
+    bool restore(const TableSnapshot& snapshot);
+
+    bool is_at_rest() const;
+    bool can_shoot() const;
+    void shoot(float angle, float power);
+
+    // advance one step
+    void step();
+    // step until nothing is moving, returns the number of steps taken. the
+    // event engine reports the steps the same shot would have taken, and
+    // falls back to stepping if it hits MAX_EVENTS
+    int run_until_rest(int max_steps = 100000);
+
+    const BallStore& get_balls() const;
+    const std::vector<Position>& get_pockets() const;
+    const PocketZones& get_pocket_zones() const;
+    const std::vector<PocketEvent>& get_pocketed() const;
+    int get_score() const;
+    void reset_score();
+    int get_layout_version() const;
+    int get_state_version() const;
+};
+
+#endif
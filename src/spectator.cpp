@@ -0,0 +1,290 @@
+#include "spectator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+enum PacketType : std::uint8_t { KEYFRAME = 0, DELTA = 1 };
+
+// x, y, active bits in a delta's per-ball mask
+constexpr std::uint8_t CHANGED_X = 1, CHANGED_Y = 2, CHANGED_ACTIVE = 4;
+
+static void put_u16(std::vector<std::uint8_t>& out, std::uint16_t v) {
+    out.push_back(v & 0xff);
+    out.push_back(v >> 8);
+}
+
+static void put_u32(std::vector<std::uint8_t>& out, std::uint32_t v) {
+    for (int i=0; i<4; ++i) out.push_back((v >> (8*i)) & 0xff);
+}
+
+// zigzag, so small negative differences stay one byte
+static void put_signed(std::vector<std::uint8_t>& out, std::int32_t v) {
+    std::uint32_t z = ((std::uint32_t)v << 1) ^ (std::uint32_t)(v >> 31);
+    while (z >= 0x80) {
+        out.push_back((z & 0x7f) | 0x80);
+        z >>= 7;
+    }
+    out.push_back(z);
+}
+
+// bounds-checked cursor over a packet, ok goes false on a short read
+struct PacketReader {
+    const std::uint8_t* data;
+    size_t size, at;
+    bool ok;
+
+    std::uint32_t bytes(int n) {
+        if (at + n > size) {
+            ok = false;
+            return 0;
+        }
+        std::uint32_t v = 0;
+        for (int i=0; i<n; ++i) v |= (std::uint32_t)data[at++] << (8*i);
+        return v;
+    }
+
+    std::int32_t signed_varint() {
+        std::uint32_t z = 0;
+        for (int shift=0; shift<35; shift+=7) {
+            if (at >= size) break;
+            std::uint8_t b = data[at++];
+            z |= (std::uint32_t)(b & 0x7f) << shift;
+            if (!(b & 0x80)) return (std::int32_t)(z >> 1) ^ -(std::int32_t)(z & 1);
+        }
+        ok = false;
+        return 0;
+    }
+};
+
+static std::uint16_t quantize(float v) {
+    return (std::uint16_t)std::clamp(std::lround(v * SPECTATOR_POSITION_SCALE), 0L, 65535L);
+}
+
+SpectatorEncoder::SpectatorEncoder() : sequence(0), since_key(0), have_last(false), count(0), score(0), qx(), qy(), active() {}
+
+bool SpectatorEncoder::encode(const TableSnapshot& snapshot, Game game, bool keyframe, std::vector<std::uint8_t>& out) {
+    std::array<std::uint16_t, MAX_BALLS> nx, ny;
+    for (int i=0; i<snapshot.count; ++i) {
+        nx[i] = quantize(snapshot.x[i]);
+        ny[i] = quantize(snapshot.y[i]);
+    }
+
+    keyframe = keyframe || !have_last || snapshot.count != count || since_key >= SPECTATOR_KEYFRAME_INTERVAL;
+
+    int changed = 0;
+    if (!keyframe) {
+        for (int i=0; i<snapshot.count; ++i) {
+            if (nx[i] != qx[i] || ny[i] != qy[i] || snapshot.active[i] != active[i]) ++changed;
+        }
+        if (changed == 0 && snapshot.score == score) return false;
+    }
+
+    out.clear();
+    put_u16(out, SPECTATOR_MAGIC);
+    out.push_back(keyframe ? KEYFRAME : DELTA);
+    put_u32(out, ++sequence);
+    put_u32(out, snapshot.frame);
+    put_signed(out, snapshot.score);
+
+    if (keyframe) {
+        out.push_back((std::uint8_t)game);
+        out.push_back(snapshot.count);
+        for (int i=0; i<snapshot.count; ++i) {
+            out.push_back(snapshot.active[i]);
+            put_u16(out, nx[i]);
+            put_u16(out, ny[i]);
+        }
+        since_key = 0;
+    } else {
+        out.push_back(changed);
+        for (int i=0; i<snapshot.count; ++i) {
+            std::uint8_t mask = (nx[i] != qx[i] ? CHANGED_X : 0) | (ny[i] != qy[i] ? CHANGED_Y : 0) |
+                                (snapshot.active[i] != active[i] ? CHANGED_ACTIVE : 0);
+            if (!mask) continue;
+            out.push_back(i);
+            out.push_back(mask);
+            if (mask & CHANGED_X) put_signed(out, nx[i] - qx[i]);
+            if (mask & CHANGED_Y) put_signed(out, ny[i] - qy[i]);
+        }
+        ++since_key;
+    }
+
+    have_last = true;
+    count = snapshot.count;
+    score = snapshot.score;
+    for (int i=0; i<count; ++i) {
+        qx[i] = nx[i];
+        qy[i] = ny[i];
+        active[i] = snapshot.active[i];
+    }
+    return true;
+}
+
+SpectatorDecoder::SpectatorDecoder()
+    : sequence(0), have_key(false), game(Game::NineBall), count(0), score(0), frame(0), qx(), qy(), active() {}
+
+bool SpectatorDecoder::decode(const std::uint8_t* data, size_t size, TableSnapshot& snapshot, Game& packet_game) {
+    PacketReader in{data, size, 0, true};
+    if (in.bytes(2) != SPECTATOR_MAGIC) return false;
+    std::uint8_t type = in.bytes(1);
+    std::uint32_t seq = in.bytes(4);
+    std::uint32_t new_frame = in.bytes(4);
+    int new_score = in.signed_varint();
+    if (!in.ok) return false;
+
+    // work on copies so a corrupt packet leaves the table as it was
+    Game new_game = game;
+    int new_count = count;
+    std::array<std::uint16_t, MAX_BALLS> nx = qx, ny = qy;
+    std::array<std::uint8_t, MAX_BALLS> na = active;
+
+    if (type == KEYFRAME) {
+        // late or duplicated, the table has already moved past it
+        if (have_key && (std::int32_t)(seq - sequence) <= 0) return false;
+
+        std::uint32_t variant = in.bytes(1);
+        new_count = in.bytes(1);
+        if (variant > (std::uint32_t)Game::FifteenRed || new_count > MAX_BALLS) return false;
+        new_game = (Game)variant;
+        for (int i=0; in.ok && i<new_count; ++i) {
+            na[i] = in.bytes(1) != 0;
+            nx[i] = in.bytes(2);
+            ny[i] = in.bytes(2);
+        }
+    } else if (type == DELTA) {
+        if (!have_key || seq != sequence + 1) {
+            have_key = have_key && (std::int32_t)(seq - sequence) <= 0; // a gap means wait for a keyframe
+            return false;
+        }
+
+        int changed = in.bytes(1);
+        for (int k=0; in.ok && k<changed; ++k) {
+            int i = in.bytes(1);
+            std::uint8_t mask = in.bytes(1);
+            if (i >= new_count) return false;
+            if (mask & CHANGED_X) nx[i] += in.signed_varint();
+            if (mask & CHANGED_Y) ny[i] += in.signed_varint();
+            if (mask & CHANGED_ACTIVE) na[i] = !na[i];
+        }
+    } else {
+        return false;
+    }
+    if (!in.ok) return false;
+
+    have_key = true;
+    sequence = seq;
+    game = new_game;
+    count = new_count;
+    score = new_score;
+    frame = new_frame;
+    qx = nx;
+    qy = ny;
+    active = na;
+
+    snapshot.count = count;
+    snapshot.num_active = 0;
+    snapshot.score = score;
+    snapshot.frame = frame;
+    for (int i=0; i<count; ++i) {
+        snapshot.x[i] = qx[i] / SPECTATOR_POSITION_SCALE;
+        snapshot.y[i] = qy[i] / SPECTATOR_POSITION_SCALE;
+        snapshot.dx[i] = 0;
+        snapshot.dy[i] = 0;
+        snapshot.active[i] = active[i];
+        snapshot.num_active += active[i];
+    }
+    packet_game = game;
+    return true;
+}
+
+SpectatorServer::SpectatorServer() : fd(-1) {}
+
+SpectatorServer::~SpectatorServer() {
+    if (fd >= 0) close(fd);
+}
+
+bool SpectatorServer::add_target(const std::string& host_port) {
+    size_t colon = host_port.rfind(':');
+    if (colon == std::string::npos) {
+        std::cerr << "Spectator Error: expected host:port, got " << host_port << "\n";
+        return false;
+    }
+    std::string host = host_port.substr(0, colon);
+    std::string port = host_port.substr(colon + 1);
+
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* result = nullptr;
+    int err = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+    if (err != 0 || !result) {
+        std::cerr << "Spectator Error: could not resolve " << host_port << ": " << gai_strerror(err) << "\n";
+        return false;
+    }
+
+    if (fd < 0) {
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        int on = 1;
+        if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on)) < 0) {
+            std::cerr << "Spectator Error: could not open a udp socket\n";
+            freeaddrinfo(result);
+            return false;
+        }
+    }
+
+    const std::uint8_t* addr = (const std::uint8_t*)result->ai_addr;
+    targets.emplace_back(addr, addr + result->ai_addrlen);
+    freeaddrinfo(result);
+    return true;
+}
+
+bool SpectatorServer::is_open() const { return fd >= 0 && !targets.empty(); }
+
+void SpectatorServer::send(const std::vector<std::uint8_t>& packet) {
+    // best effort, a dropped packet is covered by the next keyframe
+    for (const std::vector<std::uint8_t>& target : targets) {
+        sendto(fd, packet.data(), packet.size(), 0, (const sockaddr*)target.data(), target.size());
+    }
+}
+
+SpectatorClient::SpectatorClient() : fd(-1) {}
+
+SpectatorClient::~SpectatorClient() {
+    if (fd >= 0) close(fd);
+}
+
+bool SpectatorClient::listen(int port) {
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        std::cerr << "Spectator Error: could not open a udp socket\n";
+        return false;
+    }
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(fd, (const sockaddr*)&addr, sizeof(addr)) < 0) {
+        std::cerr << "Spectator Error: could not listen on port " << port << "\n";
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    return true;
+}
+
+int SpectatorClient::receive(std::uint8_t* buffer, int size, int timeout_ms) {
+    pollfd p = {fd, POLLIN, 0};
+    if (poll(&p, 1, timeout_ms) <= 0) return 0;
+    ssize_t n = recv(fd, buffer, size, 0);
+    return n > 0 ? n : 0;
+}
@@ -0,0 +1,89 @@
+#ifndef SPECTATOR_H
+#define SPECTATOR_H
+
+#include "utility.h"
+#include "simulation.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+constexpr std::uint16_t SPECTATOR_MAGIC = 0x5339; // "9S" on the wire
+// positions go out in 1/16 px, so a table coordinate fits 16 bits
+constexpr float SPECTATOR_POSITION_SCALE = 16.0f;
+// frames between keyframes while balls are moving, bounds how long a lost
+// packet leaves a spectator frozen
+constexpr int SPECTATOR_KEYFRAME_INTERVAL = 30;
+// at rest nothing is sent, bar a keyframe this often for late joiners
+constexpr int SPECTATOR_HEARTBEAT_MS = 1000;
+constexpr int SPECTATOR_MAX_PACKET = 1024;
+
+// turns published tables into packets. a keyframe carries every ball, a
+// delta only the balls whose quantized position or active flag changed since
+// the last packet, as varint differences
+class SpectatorEncoder {
+private:
+    std::uint32_t sequence;
+    int since_key;
+    bool have_last;
+    int count, score;
+    std::array<std::uint16_t, MAX_BALLS> qx, qy;
+    std::array<std::uint8_t, MAX_BALLS> active;
+
+public:
+    SpectatorEncoder();
+
+    // false when there's nothing to send: no keyframe asked for or due, and
+    // nothing changed since the last packet
+    bool encode(const TableSnapshot& snapshot, Game game, bool keyframe, std::vector<std::uint8_t>& out);
+};
+
+// rebuilds the table from packets. deltas only apply on top of the packet
+// right before them, so after a loss it waits for the next keyframe
+class SpectatorDecoder {
+private:
+    std::uint32_t sequence;
+    bool have_key;
+    Game game;
+    int count, score;
+    std::uint32_t frame;
+    std::array<std::uint16_t, MAX_BALLS> qx, qy;
+    std::array<std::uint8_t, MAX_BALLS> active;
+
+public:
+    SpectatorDecoder();
+
+    // true when the packet was applied, snapshot then holds the new picture
+    bool decode(const std::uint8_t* data, size_t size, TableSnapshot& snapshot, Game& packet_game);
+};
+
+// udp out to any number of host:port targets, broadcast addresses included
+class SpectatorServer {
+private:
+    int fd;
+    std::vector<std::vector<std::uint8_t>> targets; // raw sockaddrs
+
+public:
+    SpectatorServer();
+    ~SpectatorServer();
+
+    bool add_target(const std::string& host_port);
+    bool is_open() const;
+    void send(const std::vector<std::uint8_t>& packet);
+};
+
+class SpectatorClient {
+private:
+    int fd;
+
+public:
+    SpectatorClient();
+    ~SpectatorClient();
+
+    bool listen(int port);
+    // bytes received, 0 if nothing came within timeout_ms
+    int receive(std::uint8_t* buffer, int size, int timeout_ms);
+};
+
+#endif
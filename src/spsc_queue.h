@@ -0,0 +1,39 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+// bounded lock-free queue for exactly one producer and one consumer thread.
+// head and tail only ever grow, the slot is the index mod N
+template <typename T, size_t N>
+class SpscQueue {
+    static_assert((N & (N - 1)) == 0, "capacity must be a power of two");
+
+private:
+    T items[N];
+    alignas(64) std::atomic<size_t> head; // next to pop, written by the consumer
+    alignas(64) std::atomic<size_t> tail; // next to push, written by the producer
+
+public:
+    SpscQueue() : head(0), tail(0) {}
+
+    // false when full, the item is dropped
+    bool push(const T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == N) return false;
+        items[t % N] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        item = items[h % N];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+#endif
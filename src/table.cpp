@@ -1,248 +1,731 @@
 #include "table.h"
+#include "render.h"
 
 #include "SDL2/SDL.h"
-#include "SDL2/SDL_ttf.h"
-#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <iostream>
 
-Table::Table()
-    : is_running(true),
-      cue_ball({100, 200}, {255, 255, 255, 255}),
-      score(0) {
-    initialize_balls();
-    initialize_pockets();
+Table::Table(int physics_hz, Game game, bool offscreen)
+    : offscreen(offscreen),
+      window(nullptr),
+      surface(nullptr),
+      background(nullptr),
+      background_dirty(true),
+      background_version(-1),
+      is_running(true),
+      view_version(-1),
+      physics_pending(false),
+      render_idle(false),
+      wake_event((Uint32)-1),
+      search(pool),
+      hint(),
+      hint_version(-1),
+      frame(0),
+      playing(false),
+      fast_forward(false),
+      can_undo(false),
+      show_profile(false),
+      low_latency(false),
+      aim_ticks(0),
+      motion_pending(false),
+      motion_ticks(0),
+      streamed_at_rest(true),
+      spectating(false),
+      physics_hz(physics_hz) {
+    sim.set_rules(rules_for(game));
+    sim.set_step_rate(physics_hz);
+    sim.set_profiler(&profiler);
+    search.set_cache(&shot_cache);
+    replay.start(sim, physics_hz);
+    save_previous_state();
     initialize_SDL();
 }
 
 Table::~Table() {
-    TTF_CloseFont(font);
-    TTF_Quit();
+    is_running = false;
+    wake_physics();
+    if (physics.joinable()) physics.join();
+    if (!record_path.empty()) {
+        replay.finish(sim, frame);
+        replay.save(record_path);
+    }
+    if (!trace_path.empty()) profiler.write_trace(trace_path);
+    text.unload();
+    circles.unload();
+    if (background) SDL_DestroyTexture(background);
     SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
+    if (window) SDL_DestroyWindow(window);
+    if (surface) SDL_FreeSurface(surface);
     SDL_Quit();
 }
 
-void Table::initialize_balls() {
-    balls.clear();
-    balls.emplace_back(Position{400, 200}, SDL_Color{255, 255, 0, 255});
-    balls.emplace_back(Position{420, 190}, SDL_Color{0, 0, 255, 255});
-    balls.emplace_back(Position{420, 210}, SDL_Color{255, 0, 0, 255});
-    balls.emplace_back(Position{440, 180}, SDL_Color{255, 165, 0, 255});
-    balls.emplace_back(Position{440, 200}, SDL_Color{0, 128, 0, 255});
-    balls.emplace_back(Position{440, 220}, SDL_Color{128, 0, 128, 255});
-    balls.emplace_back(Position{460, 210}, SDL_Color{255, 20, 147, 255});
-    balls.emplace_back(Position{460, 190}, SDL_Color{0, 128, 128, 255});
-    balls.emplace_back(Position{480, 200}, SDL_Color{128, 0, 0, 255});
+// before run(), recording restarts so the replay remembers the solver
+void Table::set_contacts(Contacts contacts) {
+    sim.set_contacts(contacts);
+    replay.start(sim, physics_hz);
+}
+
+void Table::use_font(const std::string& path) {
+    text.set_font(path, FONT_SIZE);
+}
+
+void Table::set_low_latency(bool on) {
+    low_latency = on;
 }
 
-void Table::reset_balls() {
-    initialize_balls();
-    cue_ball.reset();
+void Table::record_to(const std::string& path) {
+    record_path = path;
 }
 
-void Table::initialize_pockets() {
-    const int offset = 20;
+bool Table::play(const std::string& path) {
+    if (!replay.load(path)) return false;
+    if ((int)replay.get_rack().size() >= MAX_BALLS) {
+        std::cerr << "Replay Error: " << path << " has more balls than the table holds\n";
+        return false;
+    }
+    record_path.clear();
+    player.restart(sim, replay);
+    playing = true;
+    return true;
+}
+
+void Table::undo_shot() {
+    if (playing || !can_undo) return;
+
+    // the recording rewinds with it, so the replay never shows the undone shot
+    sim.restore(undo);
+    frame = undo.frame;
+    replay.truncate(frame);
+    can_undo = false;
+    save_previous_state();
+}
 
-    pockets = {
-        {offset, offset},
-        {TABLE_WIDTH - offset, offset},
-        {offset, TABLE_HEIGHT - offset},
-        {TABLE_WIDTH - offset, TABLE_HEIGHT - offset},
-        {(int)(TABLE_WIDTH/2), offset},
-        {(int)(TABLE_WIDTH/2), TABLE_HEIGHT - offset}
-    };
+bool Table::stream_to(const std::string& host_port) {
+    return streamer.add_target(host_port);
+}
+
+bool Table::spectate(int port) {
+    spectating = receiver.listen(port);
+    return spectating;
+}
+
+void Table::stream_frame(const TableSnapshot& balls, bool keyframe) {
+    std::vector<std::uint8_t> packet;
+    if (encoder.encode(balls, sim.get_rules().game, keyframe, packet)) streamer.send(packet);
+}
+
+// one frame per physics step, rendered as fast as the simulation runs. the
+// player skips the waits between shots, so unless motion_only those are
+// filled by repeating the table at rest, and the output plays back in real
+// time at the physics rate
+bool Table::export_frames(const std::string& path, bool motion_only) {
+    if (!surface) {
+        std::cerr << "Export Error: the table isn't offscreen\n";
+        return false;
+    }
+    if (!playing) {
+        std::cerr << "Export Error: no replay loaded to export\n";
+        return false;
+    }
+
+    FrameExporter exporter;
+    if (!exporter.open(path, surface->w, surface->h)) return false;
+
+    save_previous_state();
+    view = sim;
+    view.set_profiler(nullptr);
+
+    const std::vector<ReplayShot>& shots = replay.get_shots();
+    bool was_moving = true; // so the rack goes out before the break
+    bool ok = true;
+    while (ok) {
+        publish(std::chrono::steady_clock::now());
+        const FrameState& state = frames.read();
+        sync_view(state);
+
+        bool moving = !state.at_rest;
+        if (!motion_only || moving || was_moving) {
+            // the stick lines up on the shot about to be played
+            size_t next = player.get_next_shot();
+            if (next < shots.size()) cue.aim(view.get_balls().get_position(CUE_BALL), shots[next].angle);
+            render(state, 1.0f);
+
+            std::uint32_t copies = 1;
+            if (!motion_only && state.at_rest) {
+                std::uint32_t until = next < shots.size() ? shots[next].frame : replay.get_end_frame();
+                if (until > player.get_frame()) copies = until - player.get_frame();
+            }
+            for (std::uint32_t i=0; ok && i<copies; ++i) ok = exporter.submit(surface->pixels, surface->pitch);
+        }
+        was_moving = moving;
+
+        if (player.is_finished()) break;
+        update();
+    }
+
+    exporter.close();
+    if (!ok) {
+        std::cerr << "Export Error: writing to " << path << " failed\n";
+        return false;
+    }
+    std::cerr << "Exported " << exporter.get_frames() << " frames to " << path << "\n";
+    return true;
+}
+
+void Table::trace_to(const std::string& path) {
+    trace_path = path;
+    profiler.start_trace();
+}
+
+// back rewinds to just before the last shot taken, forward plays out the
+// upcoming one and stops before the one after
+void Table::seek_shot(int delta) {
+    int target = (int)player.get_next_shot() + (delta < 0 ? -1 : 1);
+    player.seek(sim, std::max(target, 0));
+    save_previous_state();
 }
 
 void Table::initialize_SDL() {
-    if (SDL_Init(SDL_INIT_VIDEO) < 0){
+    // the software renderer needs no video subsystem, so offscreen runs
+    // without a display
+    if (SDL_Init(offscreen ? 0 : SDL_INIT_VIDEO) < 0){
         std::cerr << "SDL Initialization Error: " << SDL_GetError() << "\n";
         exit(EXIT_FAILURE);
     }
 
-    if (TTF_Init() == -1){
-        std::cerr << "SDL_ttf Initialization Error: " << TTF_GetError() << "\n";
-        SDL_Quit();
-        exit(EXIT_FAILURE);
-    }
+    if (offscreen) {
+        surface = SDL_CreateRGBSurfaceWithFormat(0, TABLE_WIDTH, TABLE_HEIGHT, 32, SDL_PIXELFORMAT_RGBA32);
+        if (!surface){
+            std::cerr << "Surface Creation Error: " << SDL_GetError() << "\n";
+            SDL_Quit();
+            exit(EXIT_FAILURE);
+        }
 
-    font = TTF_OpenFont("/Users/mdurcan/Library/Fonts/FSEX302.ttf", 24);
-    if (!font){
-        std::cerr << "Font Loading Error: " << TTF_GetError() << "\n";
-        TTF_Quit();
-        SDL_Quit();
-        exit(EXIT_FAILURE);
+        renderer = SDL_CreateSoftwareRenderer(surface);
+        if (!renderer){
+            std::cerr << "Renderer Creation Error: " << SDL_GetError() << "\n";
+            SDL_FreeSurface(surface);
+            SDL_Quit();
+            exit(EXIT_FAILURE);
+        }
+    } else {
+        window = SDL_CreateWindow("9 Ball Game", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, TABLE_WIDTH, TABLE_HEIGHT, SDL_WINDOW_SHOWN);
+        if (!window){
+            std::cerr << "Window Creation Error: " << SDL_GetError() << "\n";
+            SDL_Quit();
+            exit(EXIT_FAILURE);
+        }
+
+        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+        if (!renderer){
+            std::cerr << "Renderer Creation Error: " << SDL_GetError() << "\n";
+            SDL_DestroyWindow(window);
+            SDL_Quit();
+            exit(EXIT_FAILURE);
+        }
+
+        wake_event = SDL_RegisterEvents(1);
     }
 
-    window = SDL_CreateWindow("9 Ball Game", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, TABLE_WIDTH, TABLE_HEIGHT, SDL_WINDOW_SHOWN);
-    if (!window){
-        std::cerr << "Window Creation Error: " << SDL_GetError() << "\n";
-        SDL_Quit();
-        exit(EXIT_FAILURE);
+    text.load(renderer);
+    if (!circles.load(renderer)) {
+        std::cerr << "Circle Sprite Error: " << SDL_GetError() << ", falling back to rasterized circles\n";
     }
+}
 
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-    if (!renderer){
-        std::cerr << "Renderer Creation Error: " << SDL_GetError() << "\n";
-        SDL_DestroyWindow(window);
-        SDL_Quit();
-        exit(EXIT_FAILURE);
+bool Table::process_input() {
+    SDL_Event event;
+    bool any = false;
+    while (SDL_PollEvent(&event)) {
+        handle_event(event);
+        any = true;
     }
+    return any;
 }
 
-void Table::process_input() {
+void Table::handle_event(const SDL_Event& event) {
     const float power_step = 1.0f;
     const float min_power = 5.0f;
     const float max_power = FPS/3.0f;
 
-    SDL_Event event;
-    while (SDL_PollEvent(&event)) {
-        if (event.type == SDL_QUIT) {
-            is_running = false;
-        }
+    if (event.type == SDL_QUIT) {
+        is_running = false;
+    }
 
-        if (event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_LEFT) {
-            if (!cue_ball.is_moving()) {
-                int mouse_x, mouse_y;
-                SDL_GetMouseState(&mouse_x, &mouse_y);
-                float angle = cue.getAngle();
-                cue_ball.apply_force(angle, cue.getPower());
-            }
-        }
+    if (event.type == SDL_RENDER_TARGETS_RESET ||
+        (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)) {
+        background_dirty = true;
+    }
 
-        if (event.type == SDL_KEYDOWN) {
-            switch (event.key.keysym.sym) {
-                case SDLK_g:
-                    cue.toggle_guideline();
-                    break;
-                case SDLK_UP:
-                    cue.setPower(std::min(cue.getPower() + power_step, max_power));
-                    break;
-                case SDLK_DOWN:
-                    cue.setPower(std::max(cue.getPower() - power_step, min_power));
-                    break;
-            }
-        }
+    // motion the last aim sample already picked up has been drawn
+    if (event.type == SDL_MOUSEMOTION && !motion_pending && event.motion.timestamp > aim_ticks) {
+        motion_pending = true;
+        motion_ticks = event.motion.timestamp;
     }
-}
 
-void Table::check_collisions() {
-    // check collision between cueball and other balls
-    for (Ball& ball : balls) {
-        if (cue_ball.check_collision(ball)) {
-            cue_ball.resolve_collision(ball);
-        }
+    if (event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_LEFT) {
+        send({TableCommand::Shoot, cue.getAngle(), cue.getPower(), 0});
     }
 
-    // now non cueballs against other non cueballs
-    std::list<Ball>::iterator i,j;
-    for (i=balls.begin(); i!=balls.end(); ++i){
-        j=i;
-        ++j; // one ahead of iterator i
-        for (;j!=balls.end(); ++j){
-            if (i->check_collision(*j)){
-                i->resolve_collision(*j); // handles the movement of both balls
-            }
+    if (event.type == SDL_KEYDOWN) {
+        switch (event.key.keysym.sym) {
+            case SDLK_g:
+                cue.toggle_guideline();
+                break;
+            case SDLK_p:
+                cue.toggle_prediction();
+                break;
+            case SDLK_t:
+                show_profile = !show_profile;
+                profiler.set_enabled(show_profile);
+                break;
+            case SDLK_u:
+                send({TableCommand::Undo, 0, 0, 0});
+                break;
+            case SDLK_h:
+                suggest_shot();
+                break;
+            case SDLK_f:
+                send({TableCommand::ToggleFastForward, 0, 0, 0});
+                break;
+            case SDLK_RIGHT:
+                send({TableCommand::Seek, 0, 0, 1});
+                break;
+            case SDLK_LEFT:
+                send({TableCommand::Seek, 0, 0, -1});
+                break;
+            case SDLK_UP:
+                cue.setPower(std::min(cue.getPower() + power_step, max_power));
+                break;
+            case SDLK_DOWN:
+                cue.setPower(std::max(cue.getPower() - power_step, min_power));
+                break;
         }
     }
 }
 
-void Table::check_pockets() {
-    std::list<Ball>::iterator i = balls.begin();
-    while (i!=balls.end()){
-        if (is_ball_in_pocket(i->get_position())){
-            i = balls.erase(i);
-            ++score;
-        }else{
-            ++i;
+// runs on the render thread against view, physics keeps ticking meanwhile
+void Table::suggest_shot() {
+    if (!view.can_shoot()) return;
+    hint = search.search(view, cue.getAngle(), cue.getPower(), default_search_options());
+    hint_version = view.get_state_version();
+}
+
+void Table::render_text(const std::string& str, int x, int y) {
+    text.draw(str, x, y);
+}
+
+void Table::save_previous_state() {
+    const BallStore& balls = sim.get_balls();
+    prev_x.assign(balls.x.begin(), balls.x.begin() + balls.count);
+    prev_y.assign(balls.y.begin(), balls.y.begin() + balls.count);
+}
+
+Position Table::interpolated_position(const FrameState& state, int i, float alpha) const {
+    float x = state.balls.x[i];
+    float y = state.balls.y[i];
+    float dx = x - state.prev_x[i];
+    float dy = y - state.prev_y[i];
+
+    // snap rather than slide across the table after a scratch or re-rack
+    if (std::fabs(dx) > 2*BALL_RADIUS || std::fabs(dy) > 2*BALL_RADIUS) {
+        return {x, y};
+    }
+    return {state.prev_x[i] + dx*alpha, state.prev_y[i] + dy*alpha};
+}
+
+void Table::draw_static_layer() {
+    SDL_SetRenderDrawColor(renderer, 0, 100, 0, 255); // green
+    SDL_RenderClear(renderer);
+
+    if (circles.is_loaded()) {
+        for (const Position& pocket : view.get_pockets()) {
+            circles.add(pocket, POCKET_RADIUS, {0, 0, 0, 255});
+        }
+        circles.flush();
+    } else {
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255); // black
+        for (const Position& pocket : view.get_pockets()) {
+            render_draw_filled_circle(renderer, pocket.x, pocket.y, POCKET_RADIUS);
         }
     }
 }
 
-void Table::render_text(const std::string& str, int x, int y) {
-    SDL_Color text_color = {255, 255, 255, 255}; // white
+void Table::render_background() {
+    if (background_version != view.get_layout_version()) {
+        background_dirty = true;
+        background_version = view.get_layout_version();
+    }
 
-    SDL_Surface* text_surface = TTF_RenderText_Solid(font, str.c_str(), text_color);
-    if (!text_surface) {
-        std::cerr << "Text Rendering Error: " << TTF_GetError() << "\n";
+    if (!background && SDL_RenderTargetSupported(renderer)) {
+        background = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET,
+                                       TABLE_WIDTH, TABLE_HEIGHT);
+    }
+    if (!background) {
+        // no render targets, draw it every frame
+        draw_static_layer();
         return;
     }
 
-    SDL_Texture* text_texture = SDL_CreateTextureFromSurface(renderer, text_surface);
-    SDL_Rect text_rect = {x, y, text_surface->w, text_surface->h};
+    if (background_dirty) {
+        SDL_SetRenderTarget(renderer, background);
+        draw_static_layer();
+        SDL_SetRenderTarget(renderer, nullptr);
+        background_dirty = false;
+    }
+    SDL_RenderCopy(renderer, background, nullptr, nullptr);
+}
 
-    SDL_FreeSurface(text_surface);
+// pumps first, so the position is the newest the os has, even for motion
+// that's still queued. that motion is handled next frame but counted now
+void Table::aim_at_mouse() {
+    SDL_PumpEvents();
+    if (!motion_pending) {
+        SDL_Event queued;
+        if (SDL_PeepEvents(&queued, 1, SDL_PEEKEVENT, SDL_MOUSEMOTION, SDL_MOUSEMOTION) == 1) {
+            motion_pending = true;
+            motion_ticks = queued.motion.timestamp;
+        }
+    }
 
-    SDL_RenderCopy(renderer, text_texture, nullptr, &text_rect);
-    SDL_DestroyTexture(text_texture);
+    int mouse_x, mouse_y;
+    SDL_GetMouseState(&mouse_x, &mouse_y);
+    cue.update(view.get_balls().get_position(CUE_BALL), mouse_x, mouse_y);
+    aim_sampled_at = std::chrono::steady_clock::now();
+    aim_ticks = SDL_GetTicks();
 }
 
-void Table::render() {
-    SDL_SetRenderDrawColor(renderer, 0, 100, 0, 255); // green
-    SDL_RenderClear(renderer);
+void Table::draw_cue_layer(const FrameState& state) {
+    const BallStore& balls = view.get_balls();
+    Position cue_pos = balls.get_position(CUE_BALL);
+    cue.draw(renderer, cue_pos);
+    if (cue.is_prediction_shown() && state.at_rest) {
+        cue.draw_prediction(renderer, predictor.predict(view, cue.getAngle(), cue.getPower()));
+    } else {
+        cue.draw_guideline(renderer, cue_pos, BALL_RADIUS, TABLE_WIDTH, TABLE_HEIGHT, balls);
+    }
+    if (hint_version == view.get_state_version()) {
+        cue.draw_hint(renderer, cue_pos, hint.angle, hint.power);
+    }
+}
 
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255); // black
-    for (const Position& pocket : pockets) {
-        render_draw_filled_circle(renderer, pocket.x, pocket.y, POCKET_RADIUS);
+// right after a present, SDL timestamps are only milliseconds
+void Table::record_latency() {
+    if (!profiler.is_enabled()) {
+        motion_pending = false;
+        return;
     }
 
-    cue_ball.draw(renderer);
-    for (const Ball& ball : balls) {
-        ball.draw(renderer);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    profiler.record(Phase::AimLatency, aim_sampled_at, now);
+    if (motion_pending && motion_ticks <= aim_ticks) {
+        profiler.record(Phase::InputLatency, now - std::chrono::milliseconds(SDL_GetTicks() - motion_ticks), now);
+        motion_pending = false;
+    }
+}
+
+void Table::render(const FrameState& state, float alpha) {
+    render_background();
+
+    const BallStore& balls = view.get_balls();
+    if (circles.is_loaded()) {
+        for (int i=0; i<state.balls.count; ++i) {
+            if (state.balls.active[i]) circles.add(interpolated_position(state, i, alpha), BALL_RADIUS, balls.color[i]);
+        }
+        circles.flush();
+    } else {
+        for (int i=0; i<state.balls.count; ++i) {
+            if (state.balls.active[i]) render_draw_ball(renderer, interpolated_position(state, i, alpha), balls.color[i]);
+        }
     }
 
-    cue.draw(renderer, cue_ball.get_position());
-    cue.draw_guideline(renderer, cue_ball.get_position(), BALL_RADIUS, TABLE_WIDTH, TABLE_HEIGHT, balls);
+    if (!low_latency) draw_cue_layer(state);
 
-    render_text("Score: "+std::to_string(score), 40, 20);
+    render_text("Score: "+std::to_string(state.balls.score), 40, 20);
     render_text("Power: "+std::to_string((int)cue.getPower()), TABLE_WIDTH-150, 20);
     render_text("[G] to toggle guideline", 100, TABLE_HEIGHT-35);
+    if (playing) {
+        render_text("Replay: shot "+std::to_string(state.next_shot)+"/"+std::to_string(state.total_shots)+
+                    (state.fast_forward ? " [F] fast" : " [F]"), TABLE_WIDTH/2-120, 20);
+    }
+    if (spectating) render_text("Spectating", TABLE_WIDTH/2-60, 20);
+    if (show_profile) render_profile();
+    text.flush();
+
+    // the cue goes on top, drawn from a sample taken just now. offscreen
+    // the aim comes from the replay, not the mouse
+    if (low_latency) {
+        if (!offscreen) aim_at_mouse();
+        draw_cue_layer(state);
+    }
 
     SDL_RenderPresent(renderer);
+    if (!offscreen) record_latency();
 }
 
-bool Table::is_ball_in_pocket(const Position& ball_pos) {
-    float dx, dy, dist;
-    for (const Position& pocket : pockets) {
-        dx = ball_pos.x - pocket.x;
-        dy = ball_pos.y - pocket.y;
-        dist = std::sqrt(dx*dx + dy*dy);
-        if (dist <= POCKET_RADIUS) {
-            return true;
-        }
+void Table::render_profile() {
+    const Phase phases[] = {Phase::Input, Phase::Update, Phase::Move, Phase::Collisions,
+                            Phase::Pockets, Phase::Render, Phase::Sleep, Phase::AimLatency,
+                            Phase::InputLatency};
+    char line[96];
+    int y = 50;
+    for (Phase phase : phases) {
+        PhaseStats s = profiler.stats(phase);
+        // in microseconds, the step pieces are well under a millisecond
+        std::snprintf(line, sizeof(line), "%-10s p50 %7.1f p99 %7.1f max %7.1f us", phase_name(phase),
+                      s.p50*1000, s.p99*1000, s.max*1000);
+        render_text(line, 40, y);
+        y += 20;
     }
-    return false;
 }
 
+// one physics step, on the physics thread
 void Table::update() {
-    cue_ball.move();
-    for (Ball& ball : balls) {
-        ball.move();
+    save_previous_state();
+    if (playing) {
+        player.step(sim);
+    } else {
+        sim.step();
+        ++frame;
     }
+}
 
-    // if cueball is in the pocket (scratch), then penalize
-    if (is_ball_in_pocket(cue_ball.get_position())) {
-        score -= 5;
-        cue_ball.reset();
+void Table::handle(const TableCommand& command) {
+    switch (command.type) {
+        case TableCommand::Shoot:
+            if (!playing && sim.can_shoot()) {
+                can_undo = sim.save(undo, frame);
+                replay.record_shot(frame, command.angle, command.power);
+                sim.shoot(command.angle, command.power);
+            }
+            break;
+        case TableCommand::Undo:
+            undo_shot();
+            break;
+        case TableCommand::Seek:
+            if (playing) seek_shot(command.delta);
+            break;
+        case TableCommand::ToggleFastForward:
+            if (playing) fast_forward = !fast_forward;
+            break;
     }
+}
 
-    int mouse_x, mouse_y;
-    SDL_GetMouseState(&mouse_x, &mouse_y);
-    cue.update(cue_ball.get_position(), mouse_x, mouse_y);
+void Table::publish(std::chrono::steady_clock::time_point stepped_at) {
+    FrameState& state = frames.write_slot();
+    sim.save(state.balls, frame);
+    state.game = sim.get_rules().game;
+    int count = state.balls.count;
+    std::copy(prev_x.begin(), prev_x.begin() + count, state.prev_x);
+    std::copy(prev_y.begin(), prev_y.begin() + count, state.prev_y);
+    state.stepped_at = stepped_at;
+    state.at_rest = sim.is_at_rest();
+    state.can_shoot = sim.can_shoot();
+    state.idle = physics_idle();
+    state.fast_forward = fast_forward;
+    state.next_shot = player.get_next_shot();
+    state.total_shots = replay.get_shots().size();
+    state.version = sim.get_state_version();
+    if (streamer.is_open()) {
+        stream_frame(state.balls, state.at_rest != streamed_at_rest);
+        streamed_at_rest = state.at_rest;
+    }
+    frames.publish();
+
+    // the render thread is blocked in SDL_WaitEventTimeout, so kick it
+    if (wake_event != (Uint32)-1 && render_idle.exchange(false)) {
+        SDL_Event event;
+        SDL_zero(event);
+        event.type = wake_event;
+        SDL_PushEvent(&event);
+    }
+}
+
+void Table::send(const TableCommand& command) {
+    commands.push(command);
+    wake_physics();
+}
+
+void Table::wake_physics() {
+    {
+        std::lock_guard<std::mutex> lock(physics_mutex);
+        physics_pending = true;
+    }
+    physics_wake.notify_one();
+}
+
+// at rest with no playback left to run, only a command can change anything
+bool Table::physics_idle() const {
+    return sim.is_at_rest() && (!playing || player.is_finished());
+}
+
+// in place of physics_loop when spectating, the table just follows the stream
+void Table::spectator_loop() {
+    using Clock = std::chrono::steady_clock;
+    SpectatorDecoder decoder;
+    std::uint8_t packet[SPECTATOR_MAX_PACKET];
+
+    while (is_running) {
+        // a spectator can't shoot, undo or seek
+        TableCommand command;
+        while (commands.pop(command)) {}
+
+        int size = receiver.receive(packet, sizeof(packet), 100);
+        TableSnapshot balls;
+        Game game;
+        if (size == 0 || !decoder.decode(packet, size, balls, game)) continue;
+
+        if (game != sim.get_rules().game) sim.set_rules(rules_for(game));
+        save_previous_state();
+        if (!sim.restore(balls)) continue;
+        frame = balls.frame;
+        publish(Clock::now());
+    }
+}
+
+void Table::physics_loop() {
+    using Clock = std::chrono::steady_clock;
+    const Clock::duration step_time = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / physics_hz));
+    const Clock::duration frame_time = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / FPS));
+    const Clock::duration max_lag = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(MAX_FRAME_TIME));
+
+    Clock::time_point next_step = Clock::now();
+    while (is_running) {
+        TableCommand command;
+        bool changed = false;
+        while (commands.pop(command)) {
+            handle(command);
+            changed = true;
+        }
 
-    check_collisions();
-    check_pockets();
+        if (physics_idle()) {
+            if (changed) publish(Clock::now());
+            std::unique_lock<std::mutex> lock(physics_mutex);
+            auto woken = [this] { return physics_pending || !is_running; };
+            if (!streamer.is_open()) {
+                physics_wake.wait(lock, woken);
+            } else if (!physics_wake.wait_for(lock, std::chrono::milliseconds(SPECTATOR_HEARTBEAT_MS), woken)) {
+                // still idle, remind spectators what the table looks like
+                TableSnapshot balls;
+                sim.save(balls, frame);
+                stream_frame(balls, true);
+            }
+            physics_pending = false;
+            next_step = Clock::now();
+            continue;
+        }
 
-    // reset non-cue balls only when all are pocketed
-    if (balls.empty()) {
-        reset_balls();
+        Clock::time_point now = Clock::now();
+        if (playing && fast_forward) {
+            // unthrottled playback, publish about once a rendered frame
+            Clock::time_point until = now + frame_time;
+            while (!player.is_finished() && Clock::now() < until) {
+                ScopedTimer timer(&profiler, Phase::Update);
+                update();
+            }
+            publish(Clock::now());
+            next_step = Clock::now();
+            continue;
+        }
+
+        // a stall longer than max_lag is dropped rather than caught up on
+        if (now - next_step > max_lag) next_step = now - max_lag;
+        bool stepped = false;
+        while (next_step <= now) {
+            ScopedTimer timer(&profiler, Phase::Update);
+            update();
+            next_step += step_time;
+            stepped = true;
+        }
+        if (stepped || changed) publish(next_step - step_time);
+
+        std::this_thread::sleep_until(next_step);
     }
 }
 
+// view follows the published balls, so previews and searches run on exactly
+// the state being drawn
+void Table::sync_view(const FrameState& state) {
+    if (state.version == view_version) return;
+    if (state.game != view.get_rules().game) view.set_rules(rules_for(state.game));
+    view.restore(state.balls);
+    view_version = state.version;
+}
+
 void Table::run() {
+    using Clock = std::chrono::steady_clock;
+    const double freq = SDL_GetPerformanceFrequency();
+    const double frame_time = 1.0 / FPS;
+    const double step_time = 1.0 / physics_hz;
+
+    // seed the first frame and the view before physics starts touching sim
+    save_previous_state();
+    view = sim;
+    view.set_profiler(nullptr);
+    publish(Clock::now());
+    physics = std::thread(spectating ? &Table::spectator_loop : &Table::physics_loop, this);
+
+    // what's on screen, so an idle table is only redrawn when it changes
+    int drawn_version = -1;
+    bool drawn_settled = false;
+    bool redraw = true;
+
     while (is_running) {
-        process_input();
-        update();
-        render();
-        SDL_Delay(1000 / FPS);
+        Uint64 frame_start = SDL_GetPerformanceCounter();
+
+        {
+            ScopedTimer timer(&profiler, Phase::Input);
+            if (process_input()) redraw = true;
+        }
+
+        const FrameState& state = frames.read();
+        sync_view(state);
+
+        if (state.idle && !redraw && drawn_settled && state.version == drawn_version) {
+            // nothing is moving and the picture is current, so block until
+            // there's input or physics publishes something new
+            render_idle = true;
+            if (frames.has_fresh()) {
+                render_idle = false;
+                continue;
+            }
+
+            SDL_Event event;
+            int woken;
+            {
+                ScopedTimer timer(&profiler, Phase::Sleep);
+                woken = SDL_WaitEventTimeout(&event, IDLE_WAIT_MS);
+            }
+            render_idle = false;
+            if (woken) {
+                if (event.type != wake_event) handle_event(event);
+                redraw = true;
+            }
+            continue;
+        }
+
+        if (!low_latency) aim_at_mouse();
+
+        {
+            ScopedTimer timer(&profiler, Phase::Render);
+            double since = std::chrono::duration<double>(Clock::now() - state.stepped_at).count();
+            double alpha = std::clamp(since / step_time, 0.0, 1.0);
+            render(state, alpha);
+            drawn_version = state.version;
+            drawn_settled = alpha >= 1.0;
+            redraw = false;
+        }
+
+        // only sleep for whatever is left of this frame
+        double elapsed = (SDL_GetPerformanceCounter() - frame_start) / freq;
+        if (elapsed < frame_time) {
+            ScopedTimer timer(&profiler, Phase::Sleep);
+            SDL_Delay((Uint32)((frame_time - elapsed) * 1000));
+        }
     }
+
+    wake_physics();
+    physics.join();
 }
@@ -2,40 +2,201 @@
 #define TABLE_H
 
 #include "utility.h"
-#include "ball.h"
+#include "simulation.h"
 #include "cue.h"
+#include "text.h"
+#include "render.h"
+#include "shot_search.h"
+#include "thread_pool.h"
+#include "replay.h"
+#include "profiler.h"
+#include "spsc_queue.h"
+#include "triple_buffer.h"
+#include "spectator.h"
+#include "frame_export.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <string>
-#include "SDL2/SDL_ttf.h"
+#include <thread>
 #include <vector>
 
+// longest frame the physics will catch up on, so a stall can't spiral
+constexpr double MAX_FRAME_TIME = 0.25;
+
+// point size for a --font ttf, the built in font has its own
+constexpr int FONT_SIZE = 24;
+
+// longest the render thread sleeps on an idle table before looking again
+constexpr int IDLE_WAIT_MS = 250;
+
+// input for the physics thread, everything else the keys do stays on the
+// render side
+struct TableCommand {
+    enum Type { Shoot, Undo, Seek, ToggleFastForward };
+    Type type;
+    float angle, power; // Shoot
+    int delta;          // Seek
+};
+
+// what physics publishes after each batch of steps, plain data so a publish
+// is a copy into the triple buffer
+struct FrameState {
+    TableSnapshot balls;
+    Game game; // the rack the balls belong to
+    float prev_x[MAX_BALLS], prev_y[MAX_BALLS]; // before the last step, to interpolate from
+    std::chrono::steady_clock::time_point stepped_at;
+    bool at_rest, can_shoot;
+    bool idle; // nothing will move until a command comes in
+    bool fast_forward;
+    int next_shot, total_shots;
+    int version; // the simulation's state version, changes whenever the balls do
+};
+
 class Table {
 private:
+    // offscreen there's no window, the renderer draws into surface instead
+    bool offscreen;
     SDL_Window* window;
+    SDL_Surface* surface;
     SDL_Renderer* renderer;
-    TTF_Font* font;
+    TextRenderer text;
+    CircleBatch circles;
+
+    // felt and pockets never move, so they're drawn once into a render target
+    // and copied each frame. redrawn on resize, target reset or layout change
+    SDL_Texture* background;
+    bool background_dirty;
+    int background_version;
+
+    void draw_static_layer();
+    void render_background();
+
+    std::atomic<bool> is_running;
+
+    // physics runs on its own thread and owns sim, the replay and undo state.
+    // the render thread only sees what's published, and keeps view, a copy
+    // of the table synced to the newest state, for previews and searches
+    Simulation sim;
+    std::thread physics;
+    SpscQueue<TableCommand, 256> commands;
+    TripleBuffer<FrameState> frames;
+
+    Simulation view;
+    int view_version;
+
+    // with nothing moving physics blocks on physics_wake until a command,
+    // and the render thread on SDL events until input or wake_event, which
+    // physics pushes if it publishes while the render side is asleep
+    std::mutex physics_mutex;
+    std::condition_variable physics_wake;
+    bool physics_pending;
+    std::atomic<bool> render_idle;
+    Uint32 wake_event;
+
+    void physics_loop();
+    void send(const TableCommand& command);
+    void wake_physics();
+    bool physics_idle() const;
+    void handle(const TableCommand& command);
+    void publish(std::chrono::steady_clock::time_point stepped_at);
+    void sync_view(const FrameState& state);
 
-    bool is_running;
-    Ball cue_ball;
     Cue cue;
-    std::list<Ball> balls;
-    std::vector<Position> pockets;
-    int score;
+    ShotPredictor predictor;
+
+    // [H] suggests a shot, drawn until the table changes. asking again on
+    // the same table replays candidates out of the cache
+    ThreadPool pool;
+    ShotCache shot_cache;
+    ShotSearch search;
+    ShotCandidate hint;
+    int hint_version;
+
+    void suggest_shot();
+
+    // every game is recorded, and saved on exit when given a path. in
+    // playback the mouse is ignored and the game is re-simulated instead
+    Replay replay;
+    ReplayPlayer player;
+    std::string record_path;
+    std::uint32_t frame;
+    bool playing;
+    bool fast_forward;
+
+    void seek_shot(int delta);
+
+    // [U] puts the table back to just before the last shot
+    TableSnapshot undo;
+    bool can_undo;
+
+    void undo_shot();
+
+    // [T] shows per-phase frame timings, --trace also dumps them on exit
+    Profiler profiler;
+    bool show_profile;
+    std::string trace_path;
+
+    void render_profile();
+
+    // the cue follows the mouse as sampled in aim_at_mouse. --low-latency
+    // samples it again right before the cue layer is drawn, last thing
+    // before the present, instead of at the start of the frame. motion
+    // timestamps are kept to measure how long input takes to show up
+    bool low_latency;
+    std::chrono::steady_clock::time_point aim_sampled_at;
+    Uint32 aim_ticks;
+    bool motion_pending;
+    Uint32 motion_ticks; // oldest motion event not on screen yet
+
+    void aim_at_mouse();
+    void draw_cue_layer(const FrameState& state);
+    void record_latency();
+
+    // --stream sends what physics publishes to spectators over udp, keyframes
+    // whenever the table starts or stops moving. --spectate shows someone
+    // else's stream in place of running physics
+    SpectatorServer streamer;
+    SpectatorEncoder encoder;
+    bool streamed_at_rest;
+    SpectatorClient receiver;
+    bool spectating;
+
+    void stream_frame(const TableSnapshot& balls, bool keyframe);
+    void spectator_loop();
+
+    // physics runs at a fixed rate, rendering at FPS, interpolating between
+    // the positions before and after the last step
+    int physics_hz;
+    std::vector<float> prev_x, prev_y;
+
+    void save_previous_state();
+    Position interpolated_position(const FrameState& state, int i, float alpha) const;
 
 public:
-    Table();
+    Table(int physics_hz = FPS, Game game = Game::NineBall, bool offscreen = false);
     ~Table();
 
-    void initialize_balls();
-    void reset_balls();
-    void initialize_pockets();
+    void set_contacts(Contacts contacts);
+    // hud text from a ttf instead of the built in font
+    void use_font(const std::string& path);
+    void set_low_latency(bool on);
+    void record_to(const std::string& path);
+    bool play(const std::string& path);
+    void trace_to(const std::string& path);
+    bool stream_to(const std::string& host_port);
+    bool spectate(int port);
+    // offscreen only, renders the loaded replay to path as raw rgba frames in
+    // place of run(). see FrameExporter for what path can be
+    bool export_frames(const std::string& path, bool motion_only);
+
     void initialize_SDL();
-    void process_input();
-    void check_collisions();
-    void check_pockets();
+    bool process_input();
+    void handle_event(const SDL_Event& event);
     void render_text(const std::string& str, int x, int y);
-    void render();
-    bool is_ball_in_pocket(const Position& ball_pos);
+    void render(const FrameState& state, float alpha = 1.0f);
     void update();
     void run();
 };
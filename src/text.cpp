@@ -0,0 +1,218 @@
+#include "text.h"
+
+#include <algorithm>
+#include <iostream>
+
+TextRenderer::TextRenderer()
+    : renderer(nullptr), font_size(0), font(nullptr), ttf_started(false), prepared(false),
+      atlas(nullptr), atlas_w(0), atlas_h(0), glyphs() {}
+
+TextRenderer::~TextRenderer() {
+    unload();
+}
+
+void TextRenderer::set_font(const std::string& path, int size) {
+    font_path = path;
+    font_size = size;
+}
+
+void TextRenderer::load(SDL_Renderer* r) {
+    renderer = r;
+    prepared = false;
+}
+
+void TextRenderer::unload() {
+    if (atlas) SDL_DestroyTexture(atlas);
+    atlas = nullptr;
+
+    for (auto& entry : cache) {
+        SDL_DestroyTexture(entry.second.texture);
+    }
+    cache.clear();
+
+    if (font) TTF_CloseFont(font);
+    font = nullptr;
+    if (ttf_started) TTF_Quit();
+    ttf_started = false;
+    prepared = false;
+}
+
+void TextRenderer::prepare() {
+    prepared = true;
+    if (!font_path.empty() && open_font()) {
+        if (!build_atlas()) {
+            std::cerr << "Glyph Atlas Error: " << TTF_GetError() << ", falling back to cached strings\n";
+        }
+        return;
+    }
+    if (!build_builtin_atlas()) {
+        std::cerr << "Glyph Atlas Error: " << SDL_GetError() << ", no hud text\n";
+    }
+}
+
+bool TextRenderer::open_font() {
+    if (TTF_Init() == -1) {
+        std::cerr << "SDL_ttf Initialization Error: " << TTF_GetError() << ", using the built in font\n";
+        return false;
+    }
+    ttf_started = true;
+
+    font = TTF_OpenFont(font_path.c_str(), font_size);
+    if (!font) {
+        std::cerr << "Font Loading Error: " << TTF_GetError() << ", using the built in font\n";
+        return false;
+    }
+    return true;
+}
+
+// each glyph's pixels blown up HUD_FONT_SCALE times into its cell, white
+// with the shape in the alpha so it's tinted and blended like a ttf atlas
+bool TextRenderer::build_builtin_atlas() {
+    const int pad_x = (HUD_CELL_W - HUD_GLYPH_COLUMNS*HUD_FONT_SCALE) / 2;
+    const int pad_y = (HUD_CELL_H - HUD_GLYPH_ROWS*HUD_FONT_SCALE) / 2;
+
+    atlas_w = GLYPH_COUNT * HUD_CELL_W;
+    atlas_h = HUD_CELL_H;
+    std::vector<Uint32> pixels(atlas_w * atlas_h, 0);
+
+    for (int i=0; i<GLYPH_COUNT; ++i) {
+        glyphs[i].src = {i*HUD_CELL_W, 0, HUD_CELL_W, HUD_CELL_H};
+        glyphs[i].advance = HUD_CELL_W;
+
+        for (int row=0; row<HUD_GLYPH_ROWS; ++row) {
+            for (int col=0; col<HUD_GLYPH_COLUMNS; ++col) {
+                if (!(HUD_FONT[i][row] & (0x10 >> col))) continue;
+                int x0 = i*HUD_CELL_W + pad_x + col*HUD_FONT_SCALE;
+                int y0 = pad_y + row*HUD_FONT_SCALE;
+                for (int y=y0; y<y0+HUD_FONT_SCALE; ++y) {
+                    std::fill_n(&pixels[y*atlas_w + x0], HUD_FONT_SCALE, 0xffffffffu);
+                }
+            }
+        }
+    }
+
+    atlas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, atlas_w, atlas_h);
+    if (!atlas) return false;
+    SDL_UpdateTexture(atlas, nullptr, pixels.data(), atlas_w * sizeof(Uint32));
+    SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+    return true;
+}
+
+bool TextRenderer::build_atlas() {
+    const SDL_Color white = {255, 255, 255, 255};
+    const int count = GLYPH_COUNT;
+
+    SDL_Surface* surfaces[count] = {};
+    atlas_w = 0;
+    atlas_h = 0;
+    bool ok = true;
+
+    for (int i=0; i<count && ok; ++i) {
+        surfaces[i] = TTF_RenderGlyph_Blended(font, FIRST_GLYPH + i, white);
+        if (!surfaces[i]) {
+            ok = false;
+            break;
+        }
+        glyphs[i].src = {atlas_w, 0, surfaces[i]->w, surfaces[i]->h};
+        if (TTF_GlyphMetrics(font, FIRST_GLYPH + i, nullptr, nullptr, nullptr, nullptr, &glyphs[i].advance) != 0) {
+            glyphs[i].advance = surfaces[i]->w;
+        }
+        atlas_w += surfaces[i]->w;
+        atlas_h = std::max(atlas_h, surfaces[i]->h);
+    }
+
+    SDL_Surface* sheet = nullptr;
+    if (ok) {
+        sheet = SDL_CreateRGBSurfaceWithFormat(0, atlas_w, atlas_h, 32, SDL_PIXELFORMAT_RGBA32);
+        ok = sheet != nullptr;
+    }
+
+    if (ok) {
+        SDL_FillRect(sheet, nullptr, 0);
+        for (int i=0; i<count; ++i) {
+            // copy the alpha as is rather than blending it onto the empty sheet
+            SDL_SetSurfaceBlendMode(surfaces[i], SDL_BLENDMODE_NONE);
+            SDL_BlitSurface(surfaces[i], nullptr, sheet, &glyphs[i].src);
+        }
+        atlas = SDL_CreateTextureFromSurface(renderer, sheet);
+        ok = atlas != nullptr;
+    }
+
+    if (ok) SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+
+    for (int i=0; i<count; ++i) {
+        if (surfaces[i]) SDL_FreeSurface(surfaces[i]);
+    }
+    if (sheet) SDL_FreeSurface(sheet);
+    return ok;
+}
+
+void TextRenderer::draw(const std::string& str, int x, int y) {
+    if (!prepared) prepare();
+    if (!atlas) {
+        if (font) draw_cached(str, x, y);
+        return;
+    }
+
+    const SDL_Color white = {255, 255, 255, 255};
+    float pen = x;
+
+    for (char c : str) {
+        if (c < FIRST_GLYPH || c > LAST_GLYPH) c = '?';
+        const Glyph& glyph = glyphs[c - FIRST_GLYPH];
+        const SDL_Rect& src = glyph.src;
+
+        float u0 = (float)src.x / atlas_w;
+        float u1 = (float)(src.x + src.w) / atlas_w;
+        float v1 = (float)src.h / atlas_h;
+
+        int base = vertices.size();
+        vertices.push_back({{pen, (float)y}, white, {u0, 0}});
+        vertices.push_back({{pen + src.w, (float)y}, white, {u1, 0}});
+        vertices.push_back({{pen + src.w, (float)y + src.h}, white, {u1, v1}});
+        vertices.push_back({{pen, (float)y + src.h}, white, {u0, v1}});
+        indices.insert(indices.end(), {base, base+1, base+2, base, base+2, base+3});
+
+        pen += glyph.advance;
+    }
+}
+
+void TextRenderer::draw_cached(const std::string& str, int x, int y) {
+    auto it = cache.find(str);
+    if (it == cache.end()) {
+        SDL_Color text_color = {255, 255, 255, 255}; // white
+
+        SDL_Surface* text_surface = TTF_RenderText_Solid(font, str.c_str(), text_color);
+        if (!text_surface) {
+            std::cerr << "Text Rendering Error: " << TTF_GetError() << "\n";
+            return;
+        }
+
+        SDL_Texture* text_texture = SDL_CreateTextureFromSurface(renderer, text_surface);
+        it = cache.emplace(str, CachedText{text_texture, text_surface->w, text_surface->h, false}).first;
+        SDL_FreeSurface(text_surface);
+    }
+
+    it->second.used = true;
+    SDL_Rect text_rect = {x, y, it->second.w, it->second.h};
+    SDL_RenderCopy(renderer, it->second.texture, nullptr, &text_rect);
+}
+
+void TextRenderer::flush() {
+    if (!indices.empty()) {
+        SDL_RenderGeometry(renderer, atlas, vertices.data(), vertices.size(), indices.data(), indices.size());
+        vertices.clear();
+        indices.clear();
+    }
+
+    // drop strings that weren't drawn this frame, e.g. the previous score
+    for (auto it = cache.begin(); it != cache.end();) {
+        if (!it->second.used) {
+            SDL_DestroyTexture(it->second.texture);
+            it = cache.erase(it);
+        } else {
+            it->second.used = false;
+            ++it;
+        }
+    }
+}
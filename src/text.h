@@ -0,0 +1,66 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include "hud_font.h"
+
+#include <SDL2/SDL.h>
+#include "SDL2/SDL_ttf.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// hud text. printable ascii is rasterized once into an atlas texture and
+// strings are queued as quads, then drawn in a single geometry call per
+// frame. the atlas comes from the built in pixel font unless a font file
+// is set, and isn't built until the first string is drawn, so SDL_ttf is
+// only started when a font file is used. if a font file's atlas can't be
+// built, whole strings are rendered to textures instead, cached on their
+// content so they only re-render when they change
+class TextRenderer {
+private:
+    struct Glyph {
+        SDL_Rect src;
+        int advance;
+    };
+
+    struct CachedText {
+        SDL_Texture* texture;
+        int w, h;
+        bool used;
+    };
+
+    SDL_Renderer* renderer;
+    std::string font_path;
+    int font_size;
+    TTF_Font* font;
+    bool ttf_started;
+    bool prepared; // the first draw has set up the font and atlas
+    SDL_Texture* atlas;
+    int atlas_w, atlas_h;
+    Glyph glyphs[GLYPH_COUNT];
+
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+    std::unordered_map<std::string, CachedText> cache;
+
+    void prepare();
+    bool open_font();
+    bool build_atlas();
+    bool build_builtin_atlas();
+    void draw_cached(const std::string& str, int x, int y);
+
+public:
+    TextRenderer();
+    ~TextRenderer();
+
+    // a ttf in place of the built in font, before the first draw
+    void set_font(const std::string& path, int size);
+    void load(SDL_Renderer* renderer);
+    // textures belong to the renderer, so this has to run before it's destroyed
+    void unload();
+    void draw(const std::string& str, int x, int y);
+    // submit everything queued this frame
+    void flush();
+};
+
+#endif
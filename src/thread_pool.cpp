@@ -0,0 +1,106 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threads)
+    : queues(threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency())),
+      generation(0),
+      remaining(0),
+      stopping(false) {
+    // the calling thread works as worker 0 during run()
+    for (int i=1; i<size(); ++i) {
+        workers.emplace_back(&ThreadPool::work, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+int ThreadPool::size() const { return queues.size(); }
+
+bool ThreadPool::take(int worker, int generation, int& task) {
+    {
+        Queue& own = queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.generation == generation && !own.tasks.empty()) {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for (int k=1; k<size(); ++k) {
+        Queue& victim = queues[(worker + k) % size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.generation == generation && !victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run_tasks(int worker, int generation) {
+    int task;
+    int finished = 0;
+    while (take(worker, generation, task)) {
+        job(worker, task);
+        ++finished;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    remaining -= finished;
+    if (remaining == 0) done.notify_all();
+}
+
+void ThreadPool::work(int worker) {
+    int seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        run_tasks(worker, seen);
+    }
+}
+
+void ThreadPool::run(int tasks, const std::function<void(int, int)>& fn) {
+    if (tasks <= 0) return;
+
+    // the job, count and tasks are all published under the lock, so a woken
+    // worker finds its queue full and a late one from the last run can't
+    // take a task before remaining covers it
+    int current;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = fn;
+        remaining = tasks;
+        current = ++generation;
+
+        // deal tasks out in contiguous blocks, stealing evens out the rest
+        for (int w=0; w<size(); ++w) {
+            std::lock_guard<std::mutex> queue_lock(queues[w].mutex);
+            queues[w].generation = current;
+            int begin = (long long)tasks * w / size();
+            int end = (long long)tasks * (w+1) / size();
+            for (int t=end-1; t>=begin; --t) queues[w].tasks.push_back(t);
+        }
+    }
+    wake.notify_all();
+
+    run_tasks(0, current);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return remaining == 0; });
+}
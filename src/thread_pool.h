@@ -0,0 +1,53 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of workers, each with its own deque of task ids. a worker takes
+// from the back of its own deque and steals from the front of the others
+// when it runs dry, so uneven tasks (long shots vs quick misses) balance out
+class ThreadPool {
+private:
+    // tasks are tagged with the run() they were dealt in, a worker still
+    // finishing the last run leaves the next one's tasks alone
+    struct Queue {
+        std::mutex mutex;
+        std::deque<int> tasks;
+        int generation = 0;
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<Queue> queues;
+    std::function<void(int, int)> job;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    int generation;
+    int remaining;
+    bool stopping;
+
+    bool take(int worker, int generation, int& task);
+    void work(int worker);
+    void run_tasks(int worker, int generation);
+
+public:
+    // 0 threads means one per core
+    explicit ThreadPool(int threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const;
+    // runs fn(worker, task) for every task in [0, tasks) and blocks until all
+    // have finished. worker is in [0, size()), handy for per-thread state
+    void run(int tasks, const std::function<void(int, int)>& fn);
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// one writer and one reader trading three slots without locks. the writer
+// fills its back slot and swaps it into the middle; the reader swaps the
+// middle out only when it holds something newer, so it always sees the
+// latest complete value and neither side ever waits on the other
+template <typename T>
+class TripleBuffer {
+private:
+    static constexpr int FRESH = 4; // set on middle when it hasn't been read yet
+
+    T slots[3];
+    std::atomic<int> middle;
+    int back;  // writer's
+    int front; // reader's
+
+public:
+    TripleBuffer() : middle(1), back(0), front(2) {}
+
+    T& write_slot() { return slots[back]; }
+
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & 3;
+    }
+
+    // whether a publish is waiting to be read
+    bool has_fresh() const { return middle.load() & FRESH; }
+
+    // the newest published value, or the last one read if nothing's new
+    const T& read() {
+        if (middle.load(std::memory_order_relaxed) & FRESH) {
+            front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+        }
+        return slots[front];
+    }
+};
+
+#endif
@@ -1,12 +1,14 @@
 #ifndef UTILITY_H
 #define UTILITY_H
 
-#include <SDL2/SDL.h>
+#include <cstdint>
+#include <limits>
 
 constexpr int TABLE_WIDTH = 800;
 constexpr int TABLE_HEIGHT = 400;
 constexpr float BALL_RADIUS = 10.0f;
 constexpr float DECELERATION = 0.98f;
+constexpr float MIN_SPEED = 0.1f; // per axis, slower than this stops
 constexpr int FPS = 60;
 constexpr float POCKET_RADIUS = 15.0f;
 constexpr float FLOAT_MAX = std::numeric_limits<float>::max();
@@ -19,8 +21,9 @@ struct Velocity {
     float dx, dy;
 };
 
-
-// used to draw balls and pockets
-void render_draw_filled_circle(SDL_Renderer* renderer, int center_x, int center_y, int radius);
+// rgba, kept free of SDL so the simulation can build headless
+struct Color {
+    std::uint8_t r, g, b, a;
+};
 
 #endif